@@ -0,0 +1,504 @@
+/* bench.cpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#include "corpus.hpp"
+#include "argparse.hpp"
+#include "tmxreader.hpp"
+#include "convert.hpp"
+#include "compress.hpp"
+#include "headerwriter.hpp"
+#include "swriter.hpp"
+#include "config.h"
+#include "tmxlite/TileLayer.hpp"
+#include <pugixml.hpp>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <vector>
+
+
+struct Arguments
+{
+	std::vector<unsigned> sizes = { 32, 256, 1024 };
+	std::vector<corpus::Encoding> encodings = { std::begin(corpus::ALL_ENCODINGS), std::end(corpus::ALL_ENCODINGS) };
+	std::vector<unsigned> tilesets = { 1, 4 };
+	std::vector<unsigned> objects = { 256 };
+	unsigned iterations = 5;
+	std::filesystem::path corpusDir = std::filesystem::temp_directory_path() / "tmx2gba_bench";
+	std::string outPath;
+	bool help = false;
+};
+
+using ArgParse::Option;
+
+static const ArgParse::Options options =
+{
+	Option::Optional('h', {},          "Display this help & command info"),
+	Option::Optional('s', "n,...",     "Map sizes in tiles, square (default 32,256,1024, up to 8192)"),
+	Option::Optional('e', "enc,...",   "Layer encodings: xml,csv,base64,base64+zlib,base64+gzip,base64+zstd (default all)"),
+	Option::Optional('t', "n,...",     "Tileset counts (default 1,4)"),
+	Option::Optional('c', "n,...",     "Object counts (default 256)"),
+	Option::Optional('n', "count",     "Iterations per benchmark (default 5)"),
+	Option::Optional('d', "path",      "Directory for the generated corpus & outputs (default temp)"),
+	Option::Optional('o', "path",      "Write JSON results to a file instead of stdout")
+};
+
+template <typename T>
+static std::vector<T> SplitList(const std::string_view arg, std::function<T(const std::string&)> parse)
+{
+	std::vector<T> out;
+	std::size_t beg = 0;
+	for (;;)
+	{
+		auto end = arg.find(',', beg);
+		out.emplace_back(parse(std::string(arg.substr(beg, end == std::string_view::npos ? end : end - beg))));
+		if (end == std::string_view::npos)
+			return out;
+		beg = end + 1;
+	}
+}
+
+static bool ParseArgs(int argc, char** argv, Arguments& params)
+{
+	auto parseCount = [](const std::string& s) -> unsigned
+	{
+		int n = std::stoi(s);
+		if (n < 0 || n > 8192)
+			throw std::out_of_range(s);
+		return static_cast<unsigned>(n);
+	};
+	auto parseEncoding = [](const std::string& s) -> corpus::Encoding
+	{
+		auto encoding = corpus::ParseEncoding(s);
+		if (!encoding.has_value())
+			throw std::invalid_argument(s);
+		return encoding.value();
+	};
+
+	auto parser = ArgParse::ArgParser(argv[0], options, [&](int opt, const std::string_view arg)
+		-> ArgParse::ParseCtrl
+	{
+		using ArgParse::ParseCtrl;
+		try
+		{
+			switch (opt)
+			{
+			case 'h': params.help = true; return ParseCtrl::QUIT_EARLY;
+			case 's': params.sizes = SplitList<unsigned>(arg, parseCount);                 return ParseCtrl::CONTINUE;
+			case 'e': params.encodings = SplitList<corpus::Encoding>(arg, parseEncoding);  return ParseCtrl::CONTINUE;
+			case 't': params.tilesets = SplitList<unsigned>(arg, parseCount);              return ParseCtrl::CONTINUE;
+			case 'c': params.objects = SplitList<unsigned>(arg, parseCount);               return ParseCtrl::CONTINUE;
+			case 'n': params.iterations = std::max(1u, parseCount(std::string(arg)));     return ParseCtrl::CONTINUE;
+			case 'd': params.corpusDir = arg; return ParseCtrl::CONTINUE;
+			case 'o': params.outPath = arg;   return ParseCtrl::CONTINUE;
+
+			default: return ParseCtrl::QUIT_ERR_UNKNOWN;
+			}
+		}
+		catch (std::invalid_argument const&) { return ParseCtrl::QUIT_ERR_INVALID; }
+		catch (std::out_of_range const&) { return ParseCtrl::QUIT_ERR_RANGE; }
+	});
+
+	if (!parser.Parse(std::span(argv + 1, argc - 1)))
+		return false;
+	if (std::find(params.sizes.begin(), params.sizes.end(), 0u) != params.sizes.end())
+	{
+		parser.DisplayError("Map sizes must be non-zero.");
+		return false;
+	}
+	return true;
+}
+
+
+struct Result
+{
+	std::string benchmark;
+	corpus::Spec spec;
+	std::size_t bytes;
+	std::vector<double> seconds;
+
+	[[nodiscard]] double Min() const { return *std::min_element(seconds.begin(), seconds.end()); }
+	[[nodiscard]] double Mean() const
+	{
+		return std::accumulate(seconds.begin(), seconds.end(), 0.0) / static_cast<double>(seconds.size());
+	}
+	[[nodiscard]] double Median() const
+	{
+		auto sorted = seconds;
+		std::sort(sorted.begin(), sorted.end());
+		const auto mid = sorted.size() / 2;
+		return sorted.size() % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) * 0.5;
+	}
+	[[nodiscard]] double MegabytesPerSec() const
+	{
+		const double median = Median();
+		return median > 0.0 ? static_cast<double>(bytes) / median / 1e6 : 0.0;
+	}
+};
+
+// Keeps results of timed work observable so it isn't optimised away
+static volatile std::size_t sink;
+
+template <typename F>
+static Result Measure(const std::string_view benchmark, const corpus::Spec& spec, std::size_t bytes,
+	unsigned iterations, F&& fn)
+{
+	Result result { std::string(benchmark), spec, bytes, {} };
+	result.seconds.reserve(iterations);
+	for (unsigned i = 0; i < iterations; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		fn();
+		result.seconds.emplace_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	std::cerr << std::left << std::setw(32) << result.benchmark << std::setw(32) << spec.Name() << std::right
+		<< std::fixed << std::setprecision(3) << std::setw(12) << result.Median() * 1e3 << " ms"
+		<< std::setprecision(1) << std::setw(10) << result.MegabytesPerSec() << " MB/s" << std::endl;
+	return result;
+}
+
+
+static std::map<std::string, uint32_t> ObjectMapping()
+{
+	std::map<std::string, uint32_t> mapping;
+	for (uint32_t i = 0; i < std::size(corpus::OBJECT_NAMES); ++i)
+		mapping.emplace(corpus::OBJECT_NAMES[i], i + 1);
+	return mapping;
+}
+
+static bool OpenMap(TmxReader& tmx, const std::filesystem::path& path, const std::map<std::string, uint32_t>& objMapping)
+{
+	return tmx.Open(path.string(), "Gfx", "Pal", "Col", objMapping) == TmxReader::Error::OK;
+}
+
+static bool ConvertAndWrite(const TmxReader& tmx, const std::filesystem::path& outPath)
+{
+	std::vector<uint16_t> charDat;
+	std::vector<uint8_t> collisionDat;
+	std::vector<uint32_t> objDat;
+	if (!convert::ConvertCharmap(charDat, 0, 0, tmx) || !convert::ConvertCollision(collisionDat, tmx))
+		return false;
+	if (tmx.HasObjects() && !convert::ConvertObjects(objDat, tmx))
+		return false;
+
+	SWriter outS;
+	HeaderWriter outH;
+	if (!outS.Open(outPath.string() + ".s", "bench") || !outH.Open(outPath.string() + ".h", "bench"))
+		return false;
+	outH.WriteSize(tmx.GetSize().width, tmx.GetSize().height);
+	outH.WriteCharacterMap(charDat);
+	outH.WriteCollision(collisionDat);
+	outS.WriteArray("Tiles", charDat);
+	outS.WriteArray("Collision", collisionDat, 32);
+	if (!objDat.empty())
+	{
+		outH.WriteObjects(objDat);
+		outS.WriteArray("Objdat", objDat);
+	}
+	return true;
+}
+
+static bool RunSpec(const Arguments& p, const corpus::Spec& spec, bool encodingIndependent, std::vector<Result>& results)
+{
+	const auto objMapping = ObjectMapping();
+	const auto tmxPath = p.corpusDir / (spec.Name() + ".tmx");
+	const auto outPath = p.corpusDir / (spec.Name() + "_out");
+
+	// Generate corpus map
+	{
+		std::ofstream file(tmxPath, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to create corpus file \"" << tmxPath.string() << "\"." << std::endl;
+			return false;
+		}
+		file << corpus::Generate(spec);
+	}
+	const auto fileSize = static_cast<std::size_t>(std::filesystem::file_size(tmxPath));
+	const std::size_t numTiles = static_cast<std::size_t>(spec.width) * spec.height;
+
+	bool ok = true;
+	results.emplace_back(Measure("end-to-end", spec, fileSize, p.iterations, [&]
+	{
+		TmxReader tmx;
+		ok = ok && OpenMap(tmx, tmxPath, objMapping) && ConvertAndWrite(tmx, outPath);
+	}));
+	if (!ok)
+	{
+		std::cerr << "Failed to convert \"" << tmxPath.string() << "\"." << std::endl;
+		return false;
+	}
+
+	// Decode only the graphics layer from an already parsed document
+	{
+		pugi::xml_document doc;
+		doc.load_file(tmxPath.c_str());
+		const auto layerNode = doc.child("map").find_child_by_attribute("layer", "name", "Gfx");
+		const auto dataNode = layerNode.child("data");
+		std::size_t dataLen = std::strlen(dataNode.text().get());
+		if (!dataLen)
+		{
+			// XML keeps tiles as child elements rather than text, count them as written
+			std::ostringstream xml;
+			dataNode.print(xml, "", pugi::format_raw);
+			dataLen = xml.str().size();
+		}
+		results.emplace_back(Measure("TileLayer::parse", spec, dataLen, p.iterations, [&]
+		{
+			tmx::TileLayer layer(numTiles);
+			layer.parse(layerNode, nullptr);
+			sink = layer.getTiles().size();
+		}));
+	}
+
+	// Remaining kernels don't depend on the layer encoding
+	if (!encodingIndependent)
+		return true;
+
+	TmxReader tmx;
+	if (!OpenMap(tmx, tmxPath, objMapping))
+		return false;
+
+	results.emplace_back(Measure("TmxReader::LidFromGid", spec, numTiles * sizeof(uint32_t), p.iterations, [&]
+	{
+		std::size_t sum = 0;
+		for (const auto& tile : tmx.GetGraphicsTiles())
+			sum += tmx.LidFromGid(tile.id);
+		sink = sum;
+	}));
+
+	std::vector<uint16_t> charDat;
+	results.emplace_back(Measure("convert::ConvertCharmap", spec, numTiles * sizeof(uint16_t), p.iterations, [&]
+	{
+		charDat.clear();
+		ok = ok && convert::ConvertCharmap(charDat, 0, 0, tmx);
+	}));
+	const std::size_t charBytes = charDat.size() * sizeof(uint16_t);
+	if (convert::ScreenblocksFor(spec.width) && convert::ScreenblocksFor(spec.height))
+	{
+		results.emplace_back(Measure("convert::ArrangeScreenblocks", spec, charBytes, p.iterations, [&]
+		{
+			std::vector<uint16_t> arranged;
+			ok = ok && convert::ArrangeScreenblocks(arranged, charDat, spec.width, spec.height);
+		}));
+	}
+	results.emplace_back(Measure("convert::ArrangeColumns", spec, charBytes, p.iterations, [&]
+	{
+		std::vector<uint16_t> arranged;
+		convert::ArrangeColumns(arranged, charDat, spec.width, spec.height);
+		sink = arranged.size();
+	}));
+	results.emplace_back(Measure("convert::ArrangeStrips", spec, charBytes, p.iterations, [&]
+	{
+		std::vector<uint16_t> arranged;
+		convert::ArrangeStrips(arranged, charDat, spec.width, spec.height);
+		sink = arranged.size();
+	}));
+	// Random graphics run out of metatile indices on big maps, that only cuts the timing short
+	results.emplace_back(Measure("convert::ExtractMetatiles", spec, charBytes, p.iterations, [&]
+	{
+		convert::Metatiles metatiles;
+		sink = convert::ExtractMetatiles(metatiles, charDat, spec.width, spec.height, 2, 2, true);
+	}));
+
+	std::vector<uint8_t> collisionDat;
+	results.emplace_back(Measure("convert::ConvertCollision", spec, numTiles, p.iterations, [&]
+	{
+		collisionDat.clear();
+		ok = ok && convert::ConvertCollision(collisionDat, tmx);
+	}));
+	results.emplace_back(Measure("convert::PackCollision", spec, numTiles, p.iterations, [&]
+	{
+		std::vector<uint8_t> packed;
+		convert::CollisionBits info;
+		ok = ok && convert::PackCollision(packed, info, collisionDat, spec.width, 0);
+	}));
+	results.emplace_back(Measure("convert::FindCollisionRuns", spec, numTiles, p.iterations, [&]
+	{
+		convert::CollisionRuns rows, columns;
+		convert::FindCollisionRuns(rows, collisionDat, spec.width, spec.height, false);
+		convert::FindCollisionRuns(columns, collisionDat, spec.width, spec.height, true);
+		sink = rows.runs.size() + columns.runs.size();
+	}));
+	results.emplace_back(Measure("convert::FindRegions", spec, numTiles, p.iterations, [&]
+	{
+		convert::RegionGraph regions;
+		sink = convert::FindRegions(regions, collisionDat, spec.width, spec.height, 8, 8);
+	}));
+	if (tmx.HasObjects() && spec.objects)
+	{
+		std::vector<uint32_t> objDat;
+		results.emplace_back(Measure("convert::ConvertObjects", spec, spec.objects * 3 * sizeof(uint32_t), p.iterations, [&]
+		{
+			objDat.clear();
+			ok = ok && convert::ConvertObjects(objDat, tmx);
+		}));
+
+		// Reordering kernels work on a fresh copy each iteration, copying is timed along with them
+		const std::size_t objBytes = objDat.size() * sizeof(uint32_t);
+		results.emplace_back(Measure("convert::GroupObjects", spec, objBytes, p.iterations, [&]
+		{
+			auto objects = objDat;
+			std::vector<convert::ObjectGroup> groups;
+			convert::GroupObjects(objects, groups);
+			sink = groups.size();
+		}));
+		results.emplace_back(Measure("convert::SortObjectsByX", spec, objBytes, p.iterations, [&]
+		{
+			auto objects = objDat;
+			convert::ObjectColumns columns;
+			convert::SortObjectsByX(objects, columns, spec.width, 256);
+			sink = columns.index.size();
+		}));
+		results.emplace_back(Measure("convert::BucketObjects", spec, objBytes, p.iterations, [&]
+		{
+			auto objects = objDat;
+			convert::ObjectGrid grid;
+			convert::BucketObjects(objects, grid, spec.width, spec.height, 256, 256);
+			sink = grid.offsets.size();
+		}));
+		results.emplace_back(Measure("convert::SplitObjects", spec, objBytes, p.iterations, [&]
+		{
+			convert::ObjectArrays arrays;
+			ok = ok && convert::SplitObjects(arrays, objDat, false);
+		}));
+
+		// Goal is the first mapped object ID, fails if none of them landed on an empty tile
+		const uint32_t goals[] = { objMapping.begin()->second };
+		results.emplace_back(Measure("convert::ComputeFlowFields", spec, numTiles, p.iterations, [&]
+		{
+			std::vector<convert::FlowField> fields;
+			uint32_t failed;
+			sink = convert::ComputeFlowFields(fields, failed, goals, true, collisionDat, spec.width, spec.height, tmx);
+		}));
+	}
+
+	results.emplace_back(Measure("SWriter::WriteArray", spec, charDat.size() * sizeof(uint16_t), p.iterations, [&]
+	{
+		SWriter outS;
+		ok = ok && outS.Open(outPath.string() + "_tiles.s", "bench");
+		outS.WriteArray("Tiles", charDat);
+	}));
+
+	// Few distinct tiles make for long hash chains & short matches, the worst case for match finding
+	{
+		std::mt19937 rng(spec.seed);
+		std::vector<uint16_t> lowEntropy(numTiles);
+		for (auto& tile : lowEntropy)
+			tile = static_cast<uint16_t>(rng() % 4);
+		results.emplace_back(Measure("compress::LZ77 low entropy", spec, lowEntropy.size() * sizeof(uint16_t),
+			p.iterations, [&]
+		{
+			const auto bytes = std::span(reinterpret_cast<const uint8_t*>(lowEntropy.data()), lowEntropy.size() * 2);
+			sink = compress::LZ77(bytes, true).size();
+		}));
+	}
+
+	// Runs only match at distance 1, VRAM safe output must still find the older copies
+	{
+		const std::vector<uint8_t> run(numTiles * sizeof(uint16_t), 0);
+		const std::size_t safeSize = compress::LZ77(run, true).size();
+		const std::size_t plainSize = compress::LZ77(run, false).size();
+		if (safeSize > plainSize + plainSize / 8)
+		{
+			std::cerr << "VRAM safe LZ77 of a " << run.size() << " byte run is " << safeSize
+				<< " bytes, expected close to " << plainSize << "." << std::endl;
+			return false;
+		}
+	}
+
+	return ok;
+}
+
+
+static void WriteJson(std::ostream& out, const Arguments& p, const std::vector<Result>& results)
+{
+	out << std::fixed;
+	out << "{\n\t\"version\": \"" << TMX2GBA_VERSION << "\",\n\t\"iterations\": " << p.iterations << ",\n\t\"results\": [";
+	for (std::size_t i = 0; i < results.size(); ++i)
+	{
+		const auto& r = results[i];
+		out << (i ? "," : "") << "\n\t\t{"
+			<< "\"benchmark\": \"" << r.benchmark << "\", "
+			<< "\"map\": \"" << r.spec.Name() << "\", "
+			<< "\"width\": " << r.spec.width << ", "
+			<< "\"height\": " << r.spec.height << ", "
+			<< "\"encoding\": \"" << corpus::EncodingName(r.spec.encoding) << "\", "
+			<< "\"tilesets\": " << r.spec.tilesets << ", "
+			<< "\"objects\": " << r.spec.objects << ", "
+			<< "\"bytes\": " << r.bytes << ", "
+			<< std::setprecision(9)
+			<< "\"min_s\": " << r.Min() << ", "
+			<< "\"median_s\": " << r.Median() << ", "
+			<< "\"mean_s\": " << r.Mean() << ", "
+			<< std::setprecision(3)
+			<< "\"mbps\": " << r.MegabytesPerSec() << "}";
+	}
+	out << "\n\t]\n}" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	Arguments p;
+	if (!ParseArgs(argc, argv, p))
+		return 1;
+	if (p.help)
+	{
+		options.ShowHelpUsage(argv[0], std::cout);
+		return 0;
+	}
+
+#ifndef NDEBUG
+	std::cerr << "Warning: benchmarking a debug build, tmxlite logging goes to stdout." << std::endl;
+#endif
+
+	std::error_code ec;
+	std::filesystem::create_directories(p.corpusDir, ec);
+	if (ec)
+	{
+		std::cerr << "Failed to create corpus directory \"" << p.corpusDir.string() << "\"." << std::endl;
+		return 1;
+	}
+
+	std::vector<Result> results;
+	for (auto size : p.sizes)
+	{
+		for (auto tilesets : p.tilesets)
+		{
+			for (auto objects : p.objects)
+			{
+				for (std::size_t i = 0; i < p.encodings.size(); ++i)
+				{
+					const corpus::Spec spec = { size, size, p.encodings[i], tilesets, objects };
+					if (!RunSpec(p, spec, i == 0, results))
+						return 1;
+				}
+			}
+		}
+	}
+
+	if (p.outPath.empty())
+	{
+		WriteJson(std::cout, p, results);
+	}
+	else
+	{
+		std::ofstream file(p.outPath);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to create results file \"" << p.outPath << "\"." << std::endl;
+			return 1;
+		}
+		WriteJson(file, p, results);
+	}
+	return 0;
+}
@@ -0,0 +1,220 @@
+/* corpus.cpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#include "corpus.hpp"
+#include "base64.h"
+#include <zstd.h>
+#ifndef USE_ZLIB
+# include "miniz.h"
+#else
+# include <zlib.h>
+#endif
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+
+std::string_view corpus::EncodingName(Encoding encoding)
+{
+	switch (encoding)
+	{
+	case Encoding::XML:         return "xml";
+	case Encoding::CSV:         return "csv";
+	case Encoding::BASE64:      return "base64";
+	case Encoding::BASE64_ZLIB: return "base64+zlib";
+	case Encoding::BASE64_GZIP: return "base64+gzip";
+	case Encoding::BASE64_ZSTD: return "base64+zstd";
+	}
+	return {};
+}
+
+std::optional<corpus::Encoding> corpus::ParseEncoding(const std::string_view name)
+{
+	for (auto encoding : ALL_ENCODINGS)
+		if (EncodingName(encoding) == name)
+			return encoding;
+	return std::nullopt;
+}
+
+std::string corpus::Spec::Name() const
+{
+	std::string encoding(EncodingName(this->encoding));
+	std::replace(encoding.begin(), encoding.end(), '+', '_');
+	return std::to_string(width) + "x" + std::to_string(height) + "_" + encoding
+		+ "_t" + std::to_string(tilesets) + "_o" + std::to_string(objects);
+}
+
+
+static std::string Deflate(const std::string_view raw, bool gzip)
+{
+	z_stream stream {};
+	// Raw deflate for gzip since miniz can't write gzip headers, we wrap it ourselves
+	if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzip ? -MAX_WBITS : MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		throw std::runtime_error("deflateInit2 failed");
+
+	std::string out;
+	if (gzip)
+		out.append("\x1F\x8B\x08\x00\x00\x00\x00\x00\x00\xFF", 10);
+	const std::size_t headerLen = out.size();
+
+	out.resize(headerLen + deflateBound(&stream, static_cast<unsigned long>(raw.size())));
+	stream.next_in   = reinterpret_cast<unsigned char*>(const_cast<char*>(raw.data()));
+	stream.avail_in  = static_cast<unsigned>(raw.size());
+	stream.next_out  = reinterpret_cast<unsigned char*>(out.data() + headerLen);
+	stream.avail_out = static_cast<unsigned>(out.size() - headerLen);
+	const int result = deflate(&stream, Z_FINISH);
+	const std::size_t written = stream.total_out;
+	deflateEnd(&stream);
+	if (result != Z_STREAM_END)
+		throw std::runtime_error("deflate failed");
+	out.resize(headerLen + written);
+
+	if (gzip)
+	{
+		auto put32 = [&](uint32_t v) { for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (i * 8))); };
+		put32(static_cast<uint32_t>(crc32(0, reinterpret_cast<const unsigned char*>(raw.data()),
+			static_cast<unsigned>(raw.size()))));
+		put32(static_cast<uint32_t>(raw.size()));
+	}
+	return out;
+}
+
+static std::string ZstdCompress(const std::string_view raw)
+{
+	std::string out(ZSTD_compressBound(raw.size()), '\0');
+	const std::size_t size = ZSTD_compress(out.data(), out.size(), raw.data(), raw.size(), 3);
+	if (ZSTD_isError(size))
+		throw std::runtime_error(ZSTD_getErrorName(size));
+	out.resize(size);
+	return out;
+}
+
+std::string corpus::EncodeLayerData(std::span<const uint32_t> gids, Encoding encoding)
+{
+	std::ostringstream s;
+	switch (encoding)
+	{
+	case Encoding::XML:
+		s << "<data>\n";
+		for (auto gid : gids)
+			s << "<tile gid=\"" << gid << "\"/>\n";
+		s << "</data>";
+		return s.str();
+
+	case Encoding::CSV:
+		s << "<data encoding=\"csv\">\n";
+		for (std::size_t i = 0; i < gids.size(); ++i)
+			s << gids[i] << (i + 1 < gids.size() ? "," : "\n");
+		s << "</data>";
+		return s.str();
+
+	case Encoding::BASE64:
+	case Encoding::BASE64_ZLIB:
+	case Encoding::BASE64_GZIP:
+	case Encoding::BASE64_ZSTD:
+		break;
+	}
+
+	std::string raw;
+	raw.reserve(gids.size() * 4);
+	for (auto gid : gids)
+		for (int i = 0; i < 4; ++i)
+			raw.push_back(static_cast<char>(gid >> (i * 8)));
+
+	const char* compression = nullptr;
+	switch (encoding)
+	{
+	case Encoding::BASE64_ZLIB: raw = Deflate(raw, false); compression = "zlib"; break;
+	case Encoding::BASE64_GZIP: raw = Deflate(raw, true);  compression = "gzip"; break;
+	case Encoding::BASE64_ZSTD: raw = ZstdCompress(raw);   compression = "zstd"; break;
+	default: break;
+	}
+
+	s << "<data encoding=\"base64\"";
+	if (compression)
+		s << " compression=\"" << compression << "\"";
+	s << ">\n" << base64_encode(raw) << "\n</data>";
+	return s.str();
+}
+
+
+std::string corpus::Generate(const Spec& spec)
+{
+	constexpr unsigned TILES_PER_SET = 256;
+	constexpr uint32_t FLIP_H = 0x80000000, FLIP_V = 0x40000000;
+
+	std::mt19937 rng(spec.seed);
+	auto random = [&](uint32_t n) { return std::uniform_int_distribution<uint32_t>(0, n - 1)(rng); };
+
+	const std::size_t numTiles = static_cast<std::size_t>(spec.width) * spec.height;
+	const unsigned tilesets = std::max(spec.tilesets, 1u);
+
+	// Graphics: short runs of tiles from every tileset, some flipped
+	std::vector<uint32_t> gfx(numTiles);
+	for (std::size_t i = 0; i < numTiles;)
+	{
+		const uint32_t gid = 1 + random(tilesets) * TILES_PER_SET + random(TILES_PER_SET);
+		const uint32_t flip = random(8) == 0 ? (random(2) ? FLIP_H : FLIP_V) : 0;
+		for (auto run = 1 + random(6); run-- && i < numTiles; ++i)
+			gfx[i] = gid | flip;
+	}
+
+	// Palette: mostly default with the occasional region on another bank
+	std::vector<uint32_t> pal(numTiles);
+	for (std::size_t i = 0; i < numTiles; ++i)
+		pal[i] = random(16) == 0 ? 1 + random(16) : 0;
+
+	// Collision: empty above a wavy floor, solid below with the odd one-way platform
+	std::vector<uint32_t> col(numTiles);
+	const int height = static_cast<int>(spec.height);
+	int floor = height * 3 / 4;
+	for (unsigned x = 0; x < spec.width; ++x)
+	{
+		if (random(8) == 0)
+			floor = std::clamp(floor + static_cast<int>(random(5)) - 2, height / 2, height);
+		for (unsigned y = 0; y < spec.height; ++y)
+		{
+			uint32_t id = static_cast<int>(y) >= floor ? 2 : 0;
+			if (!id && random(64) == 0)
+				id = 3;
+			col[static_cast<std::size_t>(y) * spec.width + x] = id;
+		}
+	}
+
+	std::ostringstream s;
+	s << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		<< "<map version=\"1.10\" tiledversion=\"1.10.2\" orientation=\"orthogonal\" renderorder=\"right-down\""
+		<< " width=\"" << spec.width << "\" height=\"" << spec.height << "\""
+		<< " tilewidth=\"8\" tileheight=\"8\" infinite=\"0\" nextlayerid=\"5\" nextobjectid=\"" << spec.objects + 1 << "\">\n";
+
+	for (unsigned t = 0; t < tilesets; ++t)
+	{
+		s << " <tileset firstgid=\"" << 1 + t * TILES_PER_SET << "\" name=\"set" << t << "\""
+			<< " tilewidth=\"8\" tileheight=\"8\" tilecount=\"" << TILES_PER_SET << "\" columns=\"16\">\n"
+			<< "  <image source=\"set" << t << ".png\" width=\"128\" height=\"128\"/>\n"
+			<< " </tileset>\n";
+	}
+
+	auto layer = [&](unsigned id, const char* name, std::span<const uint32_t> gids)
+	{
+		s << " <layer id=\"" << id << "\" name=\"" << name << "\""
+			<< " width=\"" << spec.width << "\" height=\"" << spec.height << "\">\n  "
+			<< EncodeLayerData(gids, spec.encoding) << "\n </layer>\n";
+	};
+	layer(1, "Gfx", gfx);
+	layer(2, "Pal", pal);
+	layer(3, "Col", col);
+
+	s << " <objectgroup id=\"4\" name=\"Objects\">\n";
+	const auto pixelW = spec.width * 8, pixelH = spec.height * 8;
+	for (unsigned i = 0; i < spec.objects; ++i)
+	{
+		s << "  <object id=\"" << i + 1 << "\" name=\"" << OBJECT_NAMES[random(std::size(OBJECT_NAMES))] << "\""
+			<< " x=\"" << random(pixelW) << "\" y=\"" << random(pixelH) << "\" width=\"16\" height=\"16\"/>\n";
+	}
+	s << " </objectgroup>\n";
+
+	s << "</map>\n";
+	return s.str();
+}
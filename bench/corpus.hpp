@@ -0,0 +1,54 @@
+/* corpus.hpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#ifndef CORPUS_HPP
+#define CORPUS_HPP
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace corpus
+{
+	enum class Encoding
+	{
+		XML,
+		CSV,
+		BASE64,
+		BASE64_ZLIB,
+		BASE64_GZIP,
+		BASE64_ZSTD
+	};
+
+	static constexpr Encoding ALL_ENCODINGS[] =
+	{
+		Encoding::XML, Encoding::CSV, Encoding::BASE64,
+		Encoding::BASE64_ZLIB, Encoding::BASE64_GZIP, Encoding::BASE64_ZSTD
+	};
+
+	[[nodiscard]] std::string_view EncodingName(Encoding encoding);
+	[[nodiscard]] std::optional<Encoding> ParseEncoding(const std::string_view name);
+
+	struct Spec
+	{
+		unsigned width, height;
+		Encoding encoding;
+		unsigned tilesets, objects;
+		uint32_t seed = 1;
+
+		[[nodiscard]] std::string Name() const;
+	};
+
+	// Names given to generated objects, map these with -m to enable object exports
+	static constexpr std::string_view OBJECT_NAMES[] = { "coin", "enemy", "door", "spring" };
+
+	// Generated maps have a graphics layer "Gfx", a palette layer "Pal", a collision layer "Col"
+	//  and a single object group, each tileset holds 256 tiles
+	[[nodiscard]] std::string Generate(const Spec& spec);
+
+	// Encodes GIDs as the contents of a <data> element including its tags
+	[[nodiscard]] std::string EncodeLayerData(std::span<const uint32_t> gids, Encoding encoding);
+}
+
+#endif//CORPUS_HPP
@@ -0,0 +1,88 @@
+/*********************************************************************
+Matt Marchant 2016 - 2023
+http://trederia.blogspot.com
+
+tmxlite - Zlib license.
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+you must not claim that you wrote the original software.
+If you use this software in a product, an acknowledgment
+in the product documentation would be appreciated but
+is not required.
+
+2. Altered source versions must be plainly marked as such,
+and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+source distribution.
+*********************************************************************/
+
+
+#pragma once
+
+#include "tmxlite/Config.hpp"
+
+#include <cstddef>
+
+namespace tmx
+{
+    /*!
+    \brief Optional instrumentation callbacks invoked around the
+    expensive phases of loading a map, such as parsing the XML
+    document or decoding layer data. Phase names are string literals
+    and the detail string (a layer or tileset name, may be empty)
+    is only valid for the duration of the begin call.
+    Callbacks may be invoked from any thread loading a map and must
+    pair up begin and end calls on a per-thread basis.
+    */
+    struct TMXLITE_EXPORT_API ProfileHooks final
+    {
+        void (*begin)(const char* phase, const char* detail);
+        void (*end)(std::size_t bytes);
+    };
+
+    /*!
+    \brief Installs the given instrumentation hooks, or removes them if nullptr.
+    The hooks must remain valid until they are replaced.
+    */
+    TMXLITE_EXPORT_API void setProfileHooks(const ProfileHooks* hooks);
+
+    namespace detail
+    {
+        /*!
+        \brief Scoped phase that reports to the installed ProfileHooks,
+        does nothing if no hooks were installed upon construction.
+        */
+        class ProfileScope final
+        {
+        public:
+            explicit ProfileScope(const char* phase, const char* detail = "");
+            ~ProfileScope();
+
+            ProfileScope(const ProfileScope&) = delete;
+            ProfileScope& operator = (const ProfileScope&) = delete;
+
+            /*!
+            \brief Sets the number of bytes processed during this phase
+            */
+            void setBytes(std::size_t bytes) { m_bytes = bytes; }
+
+            /*!
+            \brief Ends the phase before the scope does, later calls do nothing
+            */
+            void end();
+
+        private:
+            const ProfileHooks* m_hooks;
+            std::size_t m_bytes;
+        };
+    }
+}
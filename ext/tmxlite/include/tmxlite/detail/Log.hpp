@@ -30,12 +30,15 @@ source distribution.
 #ifndef TMXLITE_LOGGER_HPP_
 #define TMXLITE_LOGGER_HPP_
 
+#include "tmxlite/Profile.hpp"
+
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
 #include <list>
+#include <mutex>
 #include <ctime>
 
 #ifdef _MSC_VER
@@ -91,6 +94,9 @@ namespace tmx
 
             if (output == Output::Console || output == Output::All)
             {
+                //maps may be loaded from several threads at once
+                detail::ProfileScope profile("Logger::log");
+                std::lock_guard<std::mutex> lock(mutex());
                 if (type == Type::Error)
                 {
                     std::cerr << outstring << std::endl;
@@ -134,6 +140,7 @@ namespace tmx
         static const std::string& bufferString(){ return stringOutput(); }
 
     private:
+        static std::mutex& mutex(){ static std::mutex mutex; return mutex; }
         static std::list<std::string>& buffer(){ static std::list<std::string> buffer; return buffer; }
         static std::string& stringOutput() { static std::string output; return output; }
         static void updateOutString(std::size_t maxBuffer)
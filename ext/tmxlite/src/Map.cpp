@@ -31,10 +31,12 @@ source distribution.
 #include "tmxlite/ImageLayer.hpp"
 #include "tmxlite/TileLayer.hpp"
 #include "tmxlite/LayerGroup.hpp"
+#include "tmxlite/Profile.hpp"
 #include "tmxlite/detail/Log.hpp"
 
 #include <pugixml.hpp>
 #include <queue>
+#include <filesystem>
 
 using namespace tmx;
 
@@ -52,11 +54,24 @@ Map::Map()
 //public
 bool Map::load(const std::string& path)
 {
+    detail::ProfileScope profile("Map::load", path.c_str());
     reset();
 
     //open the doc
     pugi::xml_document doc;
-    auto result = doc.load_file(path.c_str());
+    pugi::xml_parse_result result;
+    {
+        detail::ProfileScope xmlProfile("Map::load/xml", path.c_str());
+        result = doc.load_file(path.c_str());
+
+        std::error_code ec;
+        const auto fileSize = std::filesystem::file_size(path, ec);
+        if (!ec)
+        {
+            xmlProfile.setBytes(fileSize);
+            profile.setBytes(fileSize);
+        }
+    }
     if (!result)
     {
         Logger::log("Failed opening " + path, Logger::Type::Error);
@@ -29,6 +29,7 @@ source distribution.
 #include "tmxlite/FreeFuncs.hpp"
 #include "tmxlite/Map.hpp"
 #include "tmxlite/Tileset.hpp"
+#include "tmxlite/Profile.hpp"
 #include "tmxlite/detail/Log.hpp"
 
 #include <pugixml.hpp>
@@ -218,6 +219,7 @@ void Object::parseTemplate(const std::string& path, Map* map)
     //load the template if not already loaded
     if (templateObjects.count(path) == 0)
     {
+        detail::ProfileScope profile("Object::parseTemplate", path.c_str());
         auto templatePath = map->getWorkingDirectory() + "/" + path;
 
         pugi::xml_document doc;
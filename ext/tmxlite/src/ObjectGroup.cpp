@@ -27,6 +27,7 @@ source distribution.
 
 #include "tmxlite/FreeFuncs.hpp"
 #include "tmxlite/ObjectGroup.hpp"
+#include "tmxlite/Profile.hpp"
 #include "tmxlite/detail/Log.hpp"
 
 #include <pugixml.hpp>
@@ -44,6 +45,7 @@ ObjectGroup::ObjectGroup()
 void ObjectGroup::parse(const pugi::xml_node& node, Map* map)
 {
     assert(map);
+    detail::ProfileScope profile("ObjectGroup::parse", node.attribute("name").as_string());
 
     std::string attribString = node.name();
     if (attribString != "objectgroup")
@@ -0,0 +1,67 @@
+/*********************************************************************
+Matt Marchant 2016 - 2023
+http://trederia.blogspot.com
+
+tmxlite - Zlib license.
+
+This software is provided 'as-is', without any express or
+implied warranty. In no event will the authors be held
+liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute
+it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented;
+you must not claim that you wrote the original software.
+If you use this software in a product, an acknowledgment
+in the product documentation would be appreciated but
+is not required.
+
+2. Altered source versions must be plainly marked as such,
+and must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any
+source distribution.
+*********************************************************************/
+
+
+#include "tmxlite/Profile.hpp"
+
+#include <atomic>
+
+using namespace tmx;
+
+namespace
+{
+    std::atomic<const ProfileHooks*> installedHooks = nullptr;
+}
+
+void tmx::setProfileHooks(const ProfileHooks* hooks)
+{
+    installedHooks.store(hooks, std::memory_order_release);
+}
+
+detail::ProfileScope::ProfileScope(const char* phase, const char* detail)
+    : m_hooks   (installedHooks.load(std::memory_order_acquire)),
+    m_bytes     (0)
+{
+    if (m_hooks)
+    {
+        m_hooks->begin(phase, detail);
+    }
+}
+
+detail::ProfileScope::~ProfileScope()
+{
+    end();
+}
+
+void detail::ProfileScope::end()
+{
+    if (m_hooks)
+    {
+        m_hooks->end(m_bytes);
+        m_hooks = nullptr;
+    }
+}
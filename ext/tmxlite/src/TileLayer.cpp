@@ -28,6 +28,7 @@ source distribution.
 #include "base64.h"
 #include "tmxlite/FreeFuncs.hpp"
 #include "tmxlite/TileLayer.hpp"
+#include "tmxlite/Profile.hpp"
 #include "tmxlite/detail/Log.hpp"
 #ifndef USE_ZLIB
 # include "tmxlite/detail/gzip.hpp"
@@ -37,6 +38,8 @@ source distribution.
 #include <zstd.h>
 #include <sstream>
 #include <span>
+#include <cstring>
+#include <string_view>
 
 using namespace tmx;
 
@@ -49,6 +52,33 @@ namespace
             Zlib, GZip, Zstd, None
         };
     };
+
+    const char* dataPhase(const pugi::xml_node& node)
+    {
+        const std::string_view encoding = node.attribute("encoding").as_string();
+        const std::string_view compression = node.attribute("compression").as_string();
+        if (encoding == "csv")
+        {
+            return "TileLayer::csv";
+        }
+        if (encoding != "base64")
+        {
+            return "TileLayer::xml";
+        }
+        if (compression == "zlib")
+        {
+            return "TileLayer::base64+zlib";
+        }
+        if (compression == "gzip")
+        {
+            return "TileLayer::base64+gzip";
+        }
+        if (compression == "zstd")
+        {
+            return "TileLayer::base64+zstd";
+        }
+        return "TileLayer::base64";
+    }
 }
 
 TileLayer::TileLayer(std::size_t tileCount)
@@ -86,6 +116,9 @@ void TileLayer::parse(const pugi::xml_node& node, Map*)
         attribName = child.name();
         if (attribName == "data")
         {
+            detail::ProfileScope profile(dataPhase(child), getName().c_str());
+            profile.setBytes(std::strlen(child.text().get()));
+
             attribName = child.attribute("encoding").as_string();
             if (attribName == "base64")
             {
@@ -116,15 +149,21 @@ void TileLayer::parseBase64(const pugi::xml_node& node)
 {
     auto processDataString = [](std::string dataString, std::size_t tileCount, std::int32_t compressionType)->std::vector<std::uint32_t>
     {
+        detail::ProfileScope decodeProfile("TileLayer::base64_decode");
+        decodeProfile.setBytes(dataString.size());
         std::stringstream ss;
         ss << dataString;
         ss >> dataString;
         dataString = base64_decode(dataString);
+        decodeProfile.end();
 
         std::size_t expectedSize = tileCount * 4; //4 bytes per tile
         std::vector<unsigned char> byteData;
         byteData.reserve(expectedSize);
 
+        detail::ProfileScope inflateProfile(compressionType == CompressionType::None
+            ? "TileLayer::copy" : "TileLayer::inflate");
+        inflateProfile.setBytes(expectedSize);
         switch (compressionType)
         {
         default:
@@ -171,6 +210,7 @@ void TileLayer::parseBase64(const pugi::xml_node& node)
         }
             break;
         }
+        inflateProfile.end();
 
         //data stream is in bytes so we need to OR into 32 bit values
         std::vector<std::uint32_t> IDs;
@@ -27,6 +27,7 @@ source distribution.
 
 #include "tmxlite/Tileset.hpp"
 #include "tmxlite/FreeFuncs.hpp"
+#include "tmxlite/Profile.hpp"
 #include "tmxlite/detail/Log.hpp"
 
 #include <pugixml.hpp>
@@ -52,6 +53,7 @@ Tileset::Tileset(const std::string& workingDir)
 void Tileset::parse(pugi::xml_node node, Map* map)
 {
     assert(map);
+    detail::ProfileScope profile("Tileset::parse", node.attribute("source").as_string());
 
     std::string attribString = node.name();
     if (attribString != "tileset")
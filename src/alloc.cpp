@@ -0,0 +1,76 @@
+/* alloc.cpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#include "alloc.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	constinit thread_local alloc::Counters counters;
+	constinit thread_local bool suspended = false;
+
+	// Each block is prefixed with its counted size so frees can be subtracted without
+	//  asking the allocator, a header keeps the default new alignment of what follows it
+	constexpr std::size_t HEADER = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+	void* Allocate(std::size_t size) noexcept
+	{
+		auto* block = static_cast<unsigned char*>(std::malloc(HEADER + std::max<std::size_t>(size, 1)));
+		if (!block)
+			return nullptr;
+
+		const std::size_t counted = suspended ? 0 : size;
+		*reinterpret_cast<std::size_t*>(block) = counted;
+		if (counted)
+		{
+			++counters.allocs;
+			counters.bytes += counted;
+			counters.live  += static_cast<int64_t>(counted);
+			counters.peak   = std::max(counters.peak, counters.live);
+		}
+		return block + HEADER;
+	}
+
+	void* AllocateOrThrow(std::size_t size)
+	{
+		for (;;)
+		{
+			if (void* p = Allocate(size))
+				return p;
+			if (auto handler = std::get_new_handler())
+				handler();
+			else
+				throw std::bad_alloc();
+		}
+	}
+
+	void Deallocate(void* p) noexcept
+	{
+		if (!p)
+			return;
+		auto* block = static_cast<unsigned char*>(p) - HEADER;
+		counters.live -= static_cast<int64_t>(*reinterpret_cast<std::size_t*>(block));
+		std::free(block);
+	}
+}
+
+
+alloc::Counters& alloc::ThreadCounters() noexcept { return counters; }
+
+alloc::Suspend::Suspend() noexcept : previous(suspended) { suspended = true; }
+alloc::Suspend::~Suspend() { suspended = previous; }
+
+
+// Replacements for the global allocation functions, over-aligned forms keep their defaults
+void* operator new(std::size_t size) { return AllocateOrThrow(size); }
+void* operator new[](std::size_t size) { return AllocateOrThrow(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+
+void operator delete(void* p) noexcept { Deallocate(p); }
+void operator delete[](void* p) noexcept { Deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { Deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { Deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { Deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { Deallocate(p); }
@@ -0,0 +1,52 @@
+/* alloc.hpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#ifndef ALLOC_HPP
+#define ALLOC_HPP
+
+#include "config.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace alloc
+{
+#ifdef TMX2GBA_ALLOC_STATS
+	inline constexpr bool ENABLED = true;
+#else
+	inline constexpr bool ENABLED = false;
+#endif
+
+	// Heap activity of the calling thread, memory freed on another thread than it was
+	//  allocated on is subtracted from the freeing thread so live may go negative
+	struct Counters
+	{
+		uint64_t allocs = 0, bytes = 0;
+		int64_t live = 0, peak = 0;
+	};
+
+#ifdef TMX2GBA_ALLOC_STATS
+	[[nodiscard]] Counters& ThreadCounters() noexcept;
+
+	// Allocations made while suspended aren't counted, used to hide profiler bookkeeping
+	class Suspend
+	{
+		bool previous;
+
+	public:
+		Suspend() noexcept;
+		~Suspend();
+
+		Suspend(const Suspend&) = delete;
+		Suspend& operator=(const Suspend&) = delete;
+	};
+#else
+	[[nodiscard]] inline Counters& ThreadCounters() noexcept
+	{
+		thread_local Counters none;
+		return none;
+	}
+
+	struct Suspend {};
+#endif
+}
+
+#endif//ALLOC_HPP
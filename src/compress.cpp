@@ -0,0 +1,662 @@
+/* compress.cpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#include "compress.hpp"
+#include "profile.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <future>
+#include <map>
+#include <queue>
+
+
+std::optional<compress::Method> compress::ParseMethod(const std::string_view name)
+{
+	const auto splitter = name.find('+');
+	const auto codecName = name.substr(0, splitter);
+	const auto filterName = splitter != std::string_view::npos ? name.substr(splitter + 1) : std::string_view();
+
+	Method method;
+	if (codecName == "none")       method.codec = Codec::NONE;
+	else if (codecName == "lz77")  method.codec = Codec::LZ77;
+	else if (codecName == "rle")   method.codec = Codec::RLE;
+	else if (codecName == "huff4") method.codec = Codec::HUFF4;
+	else if (codecName == "huff8") method.codec = Codec::HUFF8;
+	else if (codecName == "auto")  method.codec = Codec::AUTO;
+	else return std::nullopt;
+
+	if (filterName == "diff8")       method.filter = Filter::DIFF8;
+	else if (filterName == "diff16") method.filter = Filter::DIFF16;
+	else if (!filterName.empty())    return std::nullopt;
+
+	// Filters only make sense ahead of a codec, auto already tries them all
+	if (method.filter != Filter::NONE && (method.codec == Codec::NONE || method.codec == Codec::AUTO))
+		return std::nullopt;
+	return method;
+}
+
+uint8_t compress::CodecType(Codec codec)
+{
+	switch (codec)
+	{
+	case Codec::LZ77:  return 0x10;
+	case Codec::RLE:   return 0x30;
+	case Codec::HUFF4: return 0x24;
+	case Codec::HUFF8: return 0x28;
+	case Codec::NONE:
+	case Codec::AUTO:  break;
+	}
+	return 0x00;
+}
+
+uint8_t compress::FilterType(Filter filter)
+{
+	switch (filter)
+	{
+	case Filter::DIFF8:  return 0x81;
+	case Filter::DIFF16: return 0x82;
+	case Filter::NONE:   break;
+	}
+	return 0x00;
+}
+
+
+static void WriteHeader(std::vector<uint8_t>& out, uint8_t type, std::size_t size)
+{
+	out.push_back(type);
+	out.push_back(static_cast<uint8_t>(size));
+	out.push_back(static_cast<uint8_t>(size >> 8));
+	out.push_back(static_cast<uint8_t>(size >> 16));
+}
+
+static void PadToWord(std::vector<uint8_t>& out)
+{
+	while (out.size() % 4)
+		out.push_back(0);
+}
+
+
+namespace
+{
+	constexpr std::size_t LZ_WINDOW  = 4096;
+	constexpr std::size_t LZ_MIN_LEN = 3;
+	constexpr std::size_t LZ_MAX_LEN = 18;
+
+	// Token costs in bits including their flag bit
+	constexpr uint32_t LZ_LITERAL_COST = 9;
+	constexpr uint32_t LZ_MATCH_COST   = 17;
+
+	constexpr unsigned HASH_BITS = 16;
+	// Nodes visited per position, only reached on degenerate input as the tree is usually shallow
+	constexpr unsigned LZ_MAX_DEPTH = 256;
+
+	struct Match
+	{
+		uint16_t length = 0, distance = 0;
+	};
+
+	// Finds the longest match at every position with a binary tree per 3-byte prefix of the positions
+	//  within the window ordered by the bytes following them, inserting a position splits the tree
+	//  around it so the longest match is always on the path taken. Positions that leave the window
+	//  are cut off when reached. A shorter match is always available at the same distance so the
+	//  longest is all parsing needs
+	std::vector<Match> FindMatches(std::span<const uint8_t> data, std::size_t minDistance)
+	{
+		const std::size_t n = data.size();
+		std::vector<Match> matches(n);
+		if (n < LZ_MIN_LEN)
+			return matches;
+
+		// Children of each position in a ring just larger than the window, smaller then larger
+		constexpr std::size_t RING = LZ_WINDOW + 1;
+		std::vector<int32_t> head(std::size_t(1) << HASH_BITS, -1);
+		std::vector<std::array<int32_t, 2>> children(std::min(n, RING));
+		auto hash = [&](std::size_t i) -> uint32_t
+		{
+			const uint32_t v = data[i] | data[i + 1] << 8 | data[i + 2] << 16;
+			return (v * 2654435761u) >> (32 - HASH_BITS);
+		};
+
+		for (std::size_t i = 0; i + LZ_MIN_LEN <= n; ++i)
+		{
+			const uint32_t h = hash(i);
+			const std::size_t maxLen = std::min(LZ_MAX_LEN, n - i);
+			int32_t candidate = head[h];
+			head[h] = static_cast<int32_t>(i);
+
+			// Where the next smaller & larger node hang off the new node's subtrees
+			auto& node = children[i % RING];
+			int32_t* smaller = &node[0];
+			int32_t* larger = &node[1];
+			std::size_t smallerLen = 0, largerLen = 0;
+
+			Match best;
+			for (unsigned depth = 0;; ++depth)
+			{
+				const std::size_t distance = i - static_cast<std::size_t>(candidate);
+				if (candidate < 0 || distance > LZ_WINDOW || depth == LZ_MAX_DEPTH)
+				{
+					*smaller = *larger = -1;
+					break;
+				}
+
+				// Everything on the path shares at least the shorter prefix of the two sides
+				const std::size_t j = static_cast<std::size_t>(candidate);
+				std::size_t length = std::min(smallerLen, largerLen);
+				while (length < maxLen && data[j + length] == data[i + length])
+					++length;
+				if (length > best.length && distance >= minDistance)
+					best = { static_cast<uint16_t>(length), static_cast<uint16_t>(distance) };
+
+				auto& pair = children[j % RING];
+				if (length == maxLen && distance >= minDistance)
+				{
+					// Identical as far as matches go, the new position takes the old one's place
+					*smaller = pair[0];
+					*larger = pair[1];
+					break;
+				}
+				if (length == maxLen)
+				{
+					// Too close to use, keep it as the new position's smaller side so older equals
+					//  stay in the tree, the closest of them is the rightmost of its smaller subtree
+					*smaller = candidate;
+					*larger = pair[1];
+					pair[1] = -1;
+					for (int32_t next = pair[0]; next >= 0 && ++depth < LZ_MAX_DEPTH; next = children[next % RING][1])
+					{
+						const std::size_t nextDistance = i - static_cast<std::size_t>(next);
+						if (nextDistance > LZ_WINDOW)
+							break;
+						const std::size_t k = static_cast<std::size_t>(next);
+						std::size_t nextLength = std::min(smallerLen, largerLen);
+						while (nextLength < maxLen && data[k + nextLength] == data[i + nextLength])
+							++nextLength;
+						if (nextLength > best.length && nextDistance >= minDistance)
+							best = { static_cast<uint16_t>(nextLength), static_cast<uint16_t>(nextDistance) };
+						if (best.length == maxLen)
+							break;
+					}
+					break;
+				}
+				if (data[j + length] < data[i + length])
+				{
+					*smaller = candidate;
+					smaller = &pair[1];
+					smallerLen = length;
+					candidate = pair[1];
+				}
+				else
+				{
+					*larger = candidate;
+					larger = &pair[0];
+					largerLen = length;
+					candidate = pair[0];
+				}
+			}
+			if (best.length >= LZ_MIN_LEN)
+				matches[i] = best;
+		}
+		return matches;
+	}
+
+	// Shortest path over token costs from the end of the input, gives the length of the
+	//  token to emit at every position (0 for a literal)
+	std::vector<uint8_t> OptimalParse(std::span<const Match> matches)
+	{
+		const std::size_t n = matches.size();
+		std::vector<uint32_t> cost(n + 1, 0);
+		std::vector<uint8_t> choice(n, 0);
+		for (std::size_t i = n; i-- > 0;)
+		{
+			cost[i] = cost[i + 1] + LZ_LITERAL_COST;
+			// Longest first so ties favour fewer tokens
+			for (std::size_t length = matches[i].length; length >= LZ_MIN_LEN; --length)
+			{
+				const uint32_t c = cost[i + length] + LZ_MATCH_COST;
+				if (c < cost[i])
+				{
+					cost[i] = c;
+					choice[i] = static_cast<uint8_t>(length);
+				}
+			}
+		}
+		return choice;
+	}
+
+	std::vector<uint8_t> EncodeLZ77(std::span<const uint8_t> data, std::size_t minDistance)
+	{
+		const auto matches = FindMatches(data, minDistance);
+		const auto choice = OptimalParse(matches);
+
+		std::vector<uint8_t> out;
+		out.reserve(4 + data.size() + data.size() / 8 + 4);
+		WriteHeader(out, compress::CodecType(compress::Codec::LZ77), data.size());
+
+		std::size_t flagPos = 0;
+		int token = 0;
+		for (std::size_t i = 0; i < data.size(); ++token)
+		{
+			// Each block is a flag byte followed by 8 tokens, set bits (MSB first) are matches
+			if (token % 8 == 0)
+			{
+				flagPos = out.size();
+				out.push_back(0);
+			}
+
+			if (const std::size_t length = choice[i]; length)
+			{
+				const std::size_t disp = matches[i].distance - 1;
+				out[flagPos] |= static_cast<uint8_t>(0x80 >> (token % 8));
+				out.push_back(static_cast<uint8_t>((length - LZ_MIN_LEN) << 4 | disp >> 8));
+				out.push_back(static_cast<uint8_t>(disp));
+				i += length;
+			}
+			else
+			{
+				out.push_back(data[i++]);
+			}
+		}
+
+		PadToWord(out);
+		return out;
+	}
+}
+
+std::vector<uint8_t> compress::LZ77(std::span<const uint8_t> data, bool vramSafe)
+{
+	profile::Scope profile("compress::LZ77");
+	profile.SetBytes(data.size());
+	return EncodeLZ77(data, vramSafe ? 2 : 1);
+}
+
+
+std::vector<uint8_t> compress::RLE(std::span<const uint8_t> data)
+{
+	profile::Scope profile("compress::RLE");
+	profile.SetBytes(data.size());
+
+	constexpr std::size_t MIN_RUN = 3, MAX_RUN = 130, MAX_LITERALS = 128;
+
+	std::vector<uint8_t> out;
+	out.reserve(4 + data.size() + data.size() / MAX_LITERALS + 4);
+	WriteHeader(out, CodecType(Codec::RLE), data.size());
+
+	// Blocks are a flag byte followed by either a run of one byte or a string of literals
+	std::size_t literals = 0;
+	auto flushLiterals = [&](std::size_t end)
+	{
+		if (!literals)
+			return;
+		out.push_back(static_cast<uint8_t>(literals - 1));
+		out.insert(out.end(), data.begin() + static_cast<std::ptrdiff_t>(end - literals),
+			data.begin() + static_cast<std::ptrdiff_t>(end));
+		literals = 0;
+	};
+
+	for (std::size_t i = 0; i < data.size();)
+	{
+		std::size_t run = 1;
+		while (i + run < data.size() && run < MAX_RUN && data[i + run] == data[i])
+			++run;
+
+		if (run >= MIN_RUN)
+		{
+			flushLiterals(i);
+			out.push_back(static_cast<uint8_t>(0x80 | (run - MIN_RUN)));
+			out.push_back(data[i]);
+			i += run;
+		}
+		else
+		{
+			++i;
+			if (++literals == MAX_LITERALS)
+				flushLiterals(i);
+		}
+	}
+	flushLiterals(data.size());
+
+	PadToWord(out);
+	return out;
+}
+
+
+namespace
+{
+	constexpr std::size_t HUFF_MAX_OFFSET = 63;
+
+	struct HuffNode
+	{
+		uint64_t freq;
+		int child[2] = { -1, -1 };
+		uint8_t symbol = 0;
+		unsigned leaves = 1;
+
+		[[nodiscard]] constexpr bool IsLeaf() const noexcept { return child[0] < 0; }
+	};
+
+	// Nodes are stored as pairs of siblings after the root, each internal node holds a 6-bit offset
+	//  to the pair with its children so they must land 1 to 64 pairs after the pair it's in.
+	// Pairs are placed one at a time picking whichever pending node has the smallest subtree, which
+	//  keeps the number of nodes waiting on a place low, unless that would leave any waiting node
+	//  unable to make its deadline. Gives the pair position of each internal node's children.
+	std::optional<std::vector<int>> LayoutHuffTree(const std::vector<HuffNode>& nodes, int root)
+	{
+		std::vector<int> childPair(nodes.size(), -1);
+		std::vector<int> deadline(nodes.size(), 0);
+		std::vector<int> pending = { root };
+		deadline[root] = static_cast<int>(HUFF_MAX_OFFSET);
+
+		auto feasible = [&](int pick, int pos)
+		{
+			std::vector<int> deadlines;
+			for (int n : pending)
+				if (n != pick)
+					deadlines.push_back(deadline[n]);
+			for (int c : nodes[pick].child)
+				if (!nodes[c].IsLeaf())
+					deadlines.push_back(pos + 1 + static_cast<int>(HUFF_MAX_OFFSET));
+			std::sort(deadlines.begin(), deadlines.end());
+			for (std::size_t j = 0; j < deadlines.size(); ++j)
+				if (deadlines[j] < pos + 1 + static_cast<int>(j))
+					return false;
+			return true;
+		};
+
+		for (int pos = 0; !pending.empty(); ++pos)
+		{
+			std::stable_sort(pending.begin(), pending.end(), [&](int a, int b)
+				{ return nodes[a].leaves < nodes[b].leaves; });
+			auto pick = std::find_if(pending.begin(), pending.end(), [&](int n) { return feasible(n, pos); });
+			if (pick == pending.end())
+				return std::nullopt;
+
+			const int node = *pick;
+			pending.erase(pick);
+			childPair[node] = pos;
+			for (int c : nodes[node].child)
+			{
+				if (!nodes[c].IsLeaf())
+				{
+					deadline[c] = pos + 1 + static_cast<int>(HUFF_MAX_OFFSET);
+					pending.push_back(c);
+				}
+			}
+		}
+		return childPair;
+	}
+}
+
+std::optional<std::vector<uint8_t>> compress::Huffman(std::span<const uint8_t> data, unsigned bits)
+{
+	profile::Scope profile("compress::Huffman");
+	profile.SetBytes(data.size());
+	assert(bits == 4 || bits == 8);
+
+	// 4-bit units are taken from the low nibble of each byte first
+	auto forEachUnit = [&](auto&& fn)
+	{
+		for (uint8_t byte : data)
+		{
+			if (bits == 8)
+			{
+				fn(byte);
+			}
+			else
+			{
+				fn(static_cast<uint8_t>(byte & 0xF));
+				fn(static_cast<uint8_t>(byte >> 4));
+			}
+		}
+	};
+
+	std::vector<uint64_t> freq(std::size_t(1) << bits, 0);
+	forEachUnit([&](uint8_t unit) { ++freq[unit]; });
+
+	// Build the tree, the root needs two children even when there's only one symbol
+	std::vector<HuffNode> nodes;
+	for (std::size_t s = 0; s < freq.size(); ++s)
+		if (freq[s])
+			nodes.emplace_back(HuffNode { .freq = freq[s], .symbol = static_cast<uint8_t>(s) });
+	while (nodes.size() < 2)
+		nodes.emplace_back(HuffNode { .freq = 0, .symbol = static_cast<uint8_t>(nodes.empty() ? 0 : !nodes[0].symbol) });
+
+	using Entry = std::pair<uint64_t, int>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+	for (std::size_t i = 0; i < nodes.size(); ++i)
+		queue.emplace(nodes[i].freq, static_cast<int>(i));
+	while (queue.size() > 1)
+	{
+		const auto [freqA, a] = queue.top(); queue.pop();
+		const auto [freqB, b] = queue.top(); queue.pop();
+		nodes.emplace_back(HuffNode { .freq = freqA + freqB, .child = { a, b },
+			.leaves = nodes[a].leaves + nodes[b].leaves });
+		queue.emplace(freqA + freqB, static_cast<int>(nodes.size() - 1));
+	}
+	const int root = queue.top().second;
+
+	const auto childPair = LayoutHuffTree(nodes, root);
+	if (!childPair.has_value())
+		return std::nullopt;
+
+	// Collect codes & the nodes of each pair
+	std::vector<std::vector<bool>> codes(freq.size());
+	std::vector<std::array<int, 2>> pairs(nodes.size() / 2);
+	std::vector<std::pair<int, std::vector<bool>>> stack = { { root, {} } };
+	while (!stack.empty())
+	{
+		auto [node, code] = std::move(stack.back());
+		stack.pop_back();
+		if (nodes[node].IsLeaf())
+		{
+			codes[nodes[node].symbol] = std::move(code);
+			continue;
+		}
+		pairs[static_cast<std::size_t>(childPair.value()[node])] = { nodes[node].child[0], nodes[node].child[1] };
+		for (int i = 0; i < 2; ++i)
+		{
+			auto childCode = code;
+			childCode.push_back(i);
+			stack.emplace_back(nodes[node].child[i], std::move(childCode));
+		}
+	}
+
+	auto nodeByte = [&](int node, int pair) -> uint8_t
+	{
+		if (nodes[node].IsLeaf())
+			return nodes[node].symbol;
+		const int offset = childPair.value()[node] - pair - 1;
+		assert(offset >= 0 && offset <= static_cast<int>(HUFF_MAX_OFFSET));
+		return static_cast<uint8_t>(offset
+			| (nodes[nodes[node].child[0]].IsLeaf() ? 0x80 : 0)
+			| (nodes[nodes[node].child[1]].IsLeaf() ? 0x40 : 0));
+	};
+
+	std::vector<uint8_t> out;
+	WriteHeader(out, CodecType(bits == 4 ? Codec::HUFF4 : Codec::HUFF8), data.size());
+
+	// Tree table is the size byte, root & pairs, padded so the bitstream stays word aligned
+	std::size_t numPairs = pairs.size();
+	if ((2 + 2 * numPairs) % 4)
+		++numPairs;
+	out.push_back(static_cast<uint8_t>(numPairs));
+	out.push_back(nodeByte(root, -1));
+	for (std::size_t i = 0; i < pairs.size(); ++i)
+	{
+		out.push_back(nodeByte(pairs[i][0], static_cast<int>(i)));
+		out.push_back(nodeByte(pairs[i][1], static_cast<int>(i)));
+	}
+	PadToWord(out);
+
+	// Bitstream is read a word at a time from the most significant bit
+	uint32_t word = 0;
+	int numBits = 0;
+	auto flush = [&]
+	{
+		for (int i = 0; i < 4; ++i)
+			out.push_back(static_cast<uint8_t>(word >> (i * 8)));
+		word = 0;
+		numBits = 0;
+	};
+	forEachUnit([&](uint8_t unit)
+	{
+		for (bool bit : codes[unit])
+		{
+			word |= static_cast<uint32_t>(bit) << (31 - numBits);
+			if (++numBits == 32)
+				flush();
+		}
+	});
+	if (numBits)
+		flush();
+
+	return out;
+}
+
+
+std::vector<uint8_t> compress::DiffFilter(std::span<const uint8_t> data, unsigned bits)
+{
+	profile::Scope profile("compress::DiffFilter");
+	profile.SetBytes(data.size());
+	assert(bits == 8 || (bits == 16 && data.size() % 2 == 0));
+
+	std::vector<uint8_t> out;
+	out.reserve(4 + data.size() + 4);
+	WriteHeader(out, FilterType(bits == 8 ? Filter::DIFF8 : Filter::DIFF16), data.size());
+	if (bits == 8)
+	{
+		uint8_t prev = 0;
+		for (uint8_t byte : data)
+		{
+			out.push_back(static_cast<uint8_t>(byte - prev));
+			prev = byte;
+		}
+	}
+	else
+	{
+		uint16_t prev = 0;
+		for (std::size_t i = 0; i < data.size(); i += 2)
+		{
+			const uint16_t unit = static_cast<uint16_t>(data[i] | data[i + 1] << 8);
+			const uint16_t diff = static_cast<uint16_t>(unit - prev);
+			out.push_back(static_cast<uint8_t>(diff));
+			out.push_back(static_cast<uint8_t>(diff >> 8));
+			prev = unit;
+		}
+	}
+	PadToWord(out);
+	return out;
+}
+
+
+static std::optional<compress::Packed> CompressAuto(std::span<const uint8_t> data, bool vramSafe)
+{
+	using namespace compress;
+	profile::Scope profile("compress::Auto");
+	profile.SetBytes(data.size());
+
+	std::vector<std::future<std::optional<Packed>>> tries;
+	for (Codec codec : { Codec::LZ77, Codec::RLE, Codec::HUFF4, Codec::HUFF8 })
+	{
+		for (Filter filter : { Filter::NONE, Filter::DIFF8, Filter::DIFF16 })
+		{
+			if (filter == Filter::DIFF16 && data.size() % 2)
+				continue;
+			tries.emplace_back(std::async(std::launch::async, [=]
+				{ return Compress(Method { codec, filter }, data, vramSafe); }));
+		}
+	}
+
+	// Smallest wins, ties go to the earliest which are the cheapest to decode
+	Packed best = { Codec::NONE, Filter::NONE, std::vector<uint8_t>(data.begin(), data.end()) };
+	for (auto& attempt : tries)
+	{
+		auto packed = attempt.get();
+		if (packed.has_value() && packed->data.size() < best.data.size())
+			best = std::move(packed.value());
+	}
+	return best;
+}
+
+std::optional<compress::Regions> compress::CompressRegions(Method method, std::span<const uint16_t> map,
+	unsigned mapWidth, unsigned mapHeight, unsigned width, unsigned height, bool vramSafe)
+{
+	profile::Scope profile("compress::CompressRegions");
+	profile.SetBytes(map.size_bytes());
+	assert(map.size() == static_cast<std::size_t>(mapWidth) * mapHeight && width && height);
+	if (method.codec == Codec::NONE || method.codec == Codec::AUTO)
+		return std::nullopt;
+
+	Regions out { width, height, (mapWidth + width - 1) / width, (mapHeight + height - 1) / height,
+		method.codec, method.filter, {}, {}, 0 };
+	out.offsets.reserve(static_cast<std::size_t>(out.columns) * out.rows);
+
+	std::map<std::vector<uint16_t>, uint32_t> seen;
+	std::vector<uint16_t> region(static_cast<std::size_t>(width) * height);
+	for (unsigned ry = 0; ry < out.rows; ++ry)
+	{
+		for (unsigned rx = 0; rx < out.columns; ++rx)
+		{
+			std::fill(region.begin(), region.end(), 0);
+			const unsigned x0 = rx * width, y0 = ry * height;
+			const unsigned copyW = std::min(width, mapWidth - x0), copyH = std::min(height, mapHeight - y0);
+			for (unsigned y = 0; y < copyH; ++y)
+			{
+				const auto row = map.begin() + static_cast<std::ptrdiff_t>((y0 + y) * mapWidth + x0);
+				std::copy(row, row + copyW, region.begin() + static_cast<std::ptrdiff_t>(y * width));
+			}
+
+			auto [it, inserted] = seen.try_emplace(region, static_cast<uint32_t>(out.data.size()));
+			if (inserted)
+			{
+				auto packed = Compress(method, std::span<const uint16_t>(region), vramSafe);
+				if (!packed.has_value())
+					return std::nullopt;
+				out.data.insert(out.data.end(), packed->data.begin(), packed->data.end());
+				PadToWord(out.data);
+				++out.unique;
+			}
+			out.offsets.emplace_back(it->second);
+		}
+	}
+	return out;
+}
+
+std::optional<compress::Packed> compress::Compress(Method method, std::span<const uint8_t> data, bool vramSafe)
+{
+	if (method.codec == Codec::AUTO)
+		return CompressAuto(data, vramSafe);
+	if (method.codec == Codec::NONE)
+		return Packed { Codec::NONE, Filter::NONE, std::vector<uint8_t>(data.begin(), data.end()) };
+
+	// Filtered data keeps its own header & is compressed in turn
+	std::vector<uint8_t> filtered;
+	if (method.filter != Filter::NONE)
+	{
+		const unsigned bits = method.filter == Filter::DIFF8 ? 8 : 16;
+		if (data.size() % (bits / 8))
+			return std::nullopt;
+		filtered = DiffFilter(data, bits);
+		data = filtered;
+		if (data.size() > MAX_SIZE)
+			return std::nullopt;
+	}
+
+	Packed packed { method.codec, method.filter, {} };
+	switch (method.codec)
+	{
+	case Codec::LZ77:  packed.data = LZ77(data, vramSafe); break;
+	case Codec::RLE:   packed.data = RLE(data); break;
+	case Codec::HUFF4:
+	case Codec::HUFF8:
+		if (auto huff = Huffman(data, method.codec == Codec::HUFF4 ? 4 : 8); huff.has_value())
+			packed.data = std::move(huff.value());
+		else
+			return std::nullopt;
+		break;
+	case Codec::NONE:
+	case Codec::AUTO:
+		break;
+	}
+	return packed;
+}
@@ -0,0 +1,102 @@
+/* compress.hpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#ifndef COMPRESS_HPP
+#define COMPRESS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace compress
+{
+	enum class Codec
+	{
+		NONE,
+		LZ77,
+		RLE,
+		HUFF4,
+		HUFF8,
+		AUTO   // Not a codec itself, tries every codec & filter and keeps the smallest
+	};
+
+	// Delta filters applied before compressing, undone by the BIOS Diff*UnFilter calls
+	enum class Filter
+	{
+		NONE,
+		DIFF8,
+		DIFF16
+	};
+
+	struct Method
+	{
+		Codec codec = Codec::NONE;
+		Filter filter = Filter::NONE;
+	};
+
+	// Largest input the 24-bit size field of BIOS compression headers can describe
+	inline constexpr std::size_t MAX_SIZE = 0xFFFFFF;
+
+	// Parses "codec[+filter]", eg. "lz77", "rle+diff8" or "auto"
+	[[nodiscard]] std::optional<Method> ParseMethod(const std::string_view name);
+
+	// BIOS header type bytes
+	[[nodiscard]] uint8_t CodecType(Codec codec);
+	[[nodiscard]] uint8_t FilterType(Filter filter);
+
+	// Compressed output array & the method that produced it
+	struct Packed
+	{
+		Codec codec;
+		Filter filter;
+		std::vector<uint8_t> data;
+	};
+
+	// Encodes for LZ77UnCompWram/LZ77UnCompVram (type 0x10), parses optimally for the smallest
+	//  output the format allows, output is padded to a multiple of 4 bytes.
+	// LZ77UnCompVram writes 16 bits at a time so copying the byte just before the write position
+	//  reads stale memory, vramSafe output never references it
+	[[nodiscard]] std::vector<uint8_t> LZ77(std::span<const uint8_t> data, bool vramSafe = false);
+
+	// Encodes for RLUnCompWram/RLUnCompVram (type 0x30)
+	[[nodiscard]] std::vector<uint8_t> RLE(std::span<const uint8_t> data);
+
+	// Encodes for HuffUnComp with 4 or 8 bit data units (type 0x24/0x28), fails when the
+	//  tree can't be laid out within the 6-bit child offsets the format allows
+	[[nodiscard]] std::optional<std::vector<uint8_t>> Huffman(std::span<const uint8_t> data, unsigned bits);
+
+	// Differences between consecutive 8 or 16-bit units (type 0x81/0x82)
+	[[nodiscard]] std::vector<uint8_t> DiffFilter(std::span<const uint8_t> data, unsigned bits);
+
+	// Applies a method, automatic selection compresses with every combination in parallel and
+	//  may decide to leave data uncompressed, fails if the requested method can't encode the data
+	[[nodiscard]] std::optional<Packed> Compress(Method method, std::span<const uint8_t> data, bool vramSafe = false);
+
+	template <typename T>
+	[[nodiscard]] std::optional<Packed> Compress(Method method, std::span<const T> data, bool vramSafe = false)
+	{
+		return Compress(method, std::span(reinterpret_cast<const uint8_t*>(data.data()), data.size_bytes()), vramSafe);
+	}
+
+	// Map split into equally sized regions compressed independently so any one can be decompressed
+	//  on its own, identical regions are stored once
+	struct Regions
+	{
+		unsigned width, height;    // Size of a region in map entries
+		unsigned columns, rows;    // Number of regions across & down the map
+		Codec codec;
+		Filter filter;
+		std::vector<uint32_t> offsets;  // Byte offset into data of each region in row-major order
+		std::vector<uint8_t> data;      // Every unique region compressed, each starts word aligned
+		std::size_t unique;
+	};
+
+	// Regions overhanging the right or bottom edge of the map are padded with zeroes,
+	//  fails if the method can't encode a region or is automatic selection
+	[[nodiscard]] std::optional<Regions> CompressRegions(Method method, std::span<const uint16_t> map,
+		unsigned mapWidth, unsigned mapHeight, unsigned width, unsigned height, bool vramSafe = false);
+}
+
+#endif//COMPRESS_HPP
@@ -2,11 +2,22 @@
 
 #include "convert.hpp"
 #include "tmxreader.hpp"
+#include "profile.hpp"
 #include <cassert>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cctype>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <future>
+#include <thread>
 
 
 bool convert::ConvertCharmap(std::vector<uint16_t>& out, int idxOffset, uint32_t defaultPal, const TmxReader& tmx)
 {
+	profile::Scope profile("convert::ConvertCharmap");
 	const auto gfxTiles = tmx.GetGraphicsTiles();
 	const auto palTiles = tmx.GetPaletteTiles();
 
@@ -38,15 +49,254 @@ bool convert::ConvertCharmap(std::vector<uint16_t>& out, int idxOffset, uint32_t
 		out.push_back(static_cast<uint16_t>(tileIdx) | static_cast<uint16_t>(flags << 8));
 	}
 
+	profile.SetBytes(out.size() * sizeof(uint16_t));
 	return true;
 }
 
+convert::AffineError convert::ConvertAffine(std::vector<uint8_t>& out, int idxOffset, const TmxReader& tmx)
+{
+	profile::Scope profile("convert::ConvertAffine");
+	const auto gfxTiles = tmx.GetGraphicsTiles();
+	const auto [width, height] = tmx.GetSize();
+	assert(gfxTiles.size() == tmx.TileCount());
+
+	const unsigned size = AffineSizeFor(std::max(width, height));
+	if (!size)
+		return AffineError::TOO_LARGE;
+
+	out.assign(static_cast<size_t>(size) * size, 0);
+	for (unsigned y = 0; y < height; ++y)
+	{
+		for (unsigned x = 0; x < width; ++x)
+		{
+			const TmxReader::Tile tile = gfxTiles[static_cast<size_t>(y) * width + x];
+			if (tile.flags & (TmxReader::FLIP_HORZ | TmxReader::FLIP_VERT | TmxReader::FLIP_DIAG))
+				return AffineError::FLIPPED;
+
+			const int tileIdx = std::max(0, static_cast<int>(tmx.LidFromGid(tile.id)) + idxOffset);
+			if (tileIdx > 0xFF)
+				return AffineError::INDEX_RANGE;
+			out[static_cast<size_t>(y) * size + x] = static_cast<uint8_t>(tileIdx);
+		}
+	}
+
+	profile.SetBytes(out.size());
+	return AffineError::OK;
+}
+
+convert::PropertyError convert::ConvertTileProperties(std::vector<TileLut>& out, std::string& failed,
+	std::span<const std::string> names, int idxOffset, const TmxReader& tmx)
+{
+	profile::Scope profile("convert::ConvertTileProperties");
+	const auto tilesets = tmx.GetTileProperties();
+
+	size_t bytes = 0;
+	out.clear();
+	for (unsigned property = 0; property < names.size(); ++property)
+	{
+		for (unsigned tileset = 0; tileset < tilesets.size(); ++tileset)
+		{
+			const auto& values = tilesets[tileset].values[property];
+			TileLut& lut = out.emplace_back(TileLut { property, tileset, false, {} });
+			lut.values.resize(std::max(0, static_cast<int>(values.size()) + idxOffset) + 1, 0);
+			for (size_t i = 0; i < values.size(); ++i)
+			{
+				const double value = std::trunc(values[i]);
+				if (std::isnan(value))
+				{
+					failed = names[property];
+					return PropertyError::NOT_A_NUMBER;
+				}
+				if (value < 0.0 || value > UINT16_MAX)
+				{
+					failed = names[property];
+					return PropertyError::OUT_OF_RANGE;
+				}
+				// Same index the charmap would hold for this tile
+				const int tileIdx = std::max(0, static_cast<int>(i + 1) + idxOffset);
+				lut.values[static_cast<size_t>(tileIdx)] = static_cast<uint16_t>(value);
+				lut.wide = lut.wide || value > UINT8_MAX;
+			}
+			bytes += lut.values.size() * (lut.wide ? 2 : 1);
+		}
+	}
+
+	profile.SetBytes(bytes);
+	return PropertyError::OK;
+}
+
+static bool InsideShape(const TmxReader::Shape& shape, float x, float y)
+{
+	// Into the shape's own unrotated space
+	x -= shape.x;
+	y -= shape.y;
+	if (shape.rotation != 0.0f)
+	{
+		const float angle = -shape.rotation * 3.14159265f / 180.0f;
+		const float c = std::cos(angle), s = std::sin(angle);
+		const float rx = x * c - y * s, ry = x * s + y * c;
+		x = rx;
+		y = ry;
+	}
+
+	using Type = TmxReader::Shape::Type;
+	switch (shape.type)
+	{
+	case Type::RECTANGLE:
+		return x >= 0.0f && y >= 0.0f && x < shape.width && y < shape.height;
+	case Type::ELLIPSE:
+	{
+		if (shape.width <= 0.0f || shape.height <= 0.0f)
+			return false;
+		const float dx = (x - shape.width / 2) / (shape.width / 2), dy = (y - shape.height / 2) / (shape.height / 2);
+		return dx * dx + dy * dy <= 1.0f;
+	}
+	case Type::POLYGON:
+	{
+		// Even-odd rule
+		bool inside = false;
+		const auto& p = shape.points;
+		for (size_t i = 0, j = p.size() - 1; i < p.size(); j = i++)
+		{
+			if ((p[i].second > y) != (p[j].second > y)
+				&& x < (p[j].first - p[i].first) * (y - p[i].second) / (p[j].second - p[i].second) + p[i].first)
+				inside = !inside;
+		}
+		return inside;
+	}
+	}
+	return false;
+}
+
+void convert::ConvertTileMasks(std::vector<TileMasks>& out, bool masks, bool heights, int idxOffset, const TmxReader& tmx)
+{
+	profile::Scope profile("convert::ConvertTileMasks");
+	constexpr unsigned SIZE = 8;
+	const auto tilesets = tmx.GetTileShapes();
+
+	size_t bytes = 0;
+	out.clear();
+	for (unsigned tileset = 0; tileset < tilesets.size(); ++tileset)
+	{
+		const auto& set = tilesets[tileset];
+		TileMasks& result = out.emplace_back(TileMasks { tileset, {}, {} });
+		const size_t count = static_cast<size_t>(std::max(0, static_cast<int>(set.tiles.size()) + idxOffset)) + 1;
+		if (masks)
+			result.masks.assign(count * SIZE, 0);
+		if (heights)
+			result.heights.assign(count * SIZE, 0);
+
+		for (size_t i = 0; i < set.tiles.size(); ++i)
+		{
+			const auto& shapes = set.tiles[i];
+			if (shapes.empty())
+				continue;
+
+			// Sample the centre of each pixel scaled to the size of the tileset's tiles
+			std::array<uint8_t, SIZE> rows {};
+			for (unsigned y = 0; y < SIZE; ++y)
+			{
+				const float sy = (y + 0.5f) * set.tileHeight / SIZE;
+				for (unsigned x = 0; x < SIZE; ++x)
+				{
+					const float sx = (x + 0.5f) * set.tileWidth / SIZE;
+					if (std::any_of(shapes.begin(), shapes.end(), [&](const auto& s) { return InsideShape(s, sx, sy); }))
+						rows[y] |= static_cast<uint8_t>(1u << x);
+				}
+			}
+
+			const size_t tileIdx = static_cast<size_t>(std::max(0, static_cast<int>(i + 1) + idxOffset));
+			if (masks)
+				std::copy(rows.begin(), rows.end(), result.masks.begin() + tileIdx * SIZE);
+			if (heights)
+			{
+				for (unsigned x = 0; x < SIZE; ++x)
+				{
+					unsigned top = 0;
+					while (top < SIZE && !(rows[top] & (1u << x)))
+						++top;
+					result.heights[tileIdx * SIZE + x] = static_cast<uint8_t>(SIZE - top);
+				}
+			}
+		}
+		bytes += result.masks.size() + result.heights.size();
+	}
+
+	profile.SetBytes(bytes);
+}
+
+void convert::ConvertAnimations(Animations& out, int idxOffset, const TmxReader& tmx)
+{
+	profile::Scope profile("convert::ConvertAnimations");
+	constexpr double REFRESH_RATE = 16777216.0 / 280896.0;  // ~59.73 Hz
+	const auto animations = tmx.GetAnimations();
+
+	auto tileIdx = [&](uint32_t gid)
+	{
+		return static_cast<uint16_t>(std::max(0, static_cast<int>(tmx.LidFromGid(gid)) + idxOffset));
+	};
+
+	out = {};
+	std::unordered_map<uint32_t, size_t> lookup;
+	for (size_t i = 0; i < animations.size(); ++i)
+	{
+		const auto& anim = animations[i];
+		lookup.emplace(anim.gid, i);
+		out.tiles.push_back(tileIdx(anim.gid));
+		out.tilesets.push_back(static_cast<uint8_t>(anim.tileset));
+		out.frameOffsets.push_back(static_cast<uint16_t>(out.frames.size()));
+		for (const auto& frame : anim.frames)
+		{
+			out.frames.push_back(tileIdx(frame.gid));
+			const double ticks = std::round(frame.duration * REFRESH_RATE / 1000.0);
+			out.durations.push_back(static_cast<uint16_t>(std::clamp(ticks, 1.0, 65535.0)));
+		}
+	}
+	out.frameOffsets.push_back(static_cast<uint16_t>(out.frames.size()));
+
+	// Bucket the positions of every animated tile on the map
+	const auto gfxTiles = tmx.GetGraphicsTiles();
+	std::vector<std::vector<uint32_t>> positions(animations.size());
+	for (size_t i = 0; i < gfxTiles.size(); ++i)
+		if (auto it = lookup.find(gfxTiles[i].id); it != lookup.end())
+			positions[it->second].push_back(static_cast<uint32_t>(i));
+	for (const auto& list : positions)
+	{
+		out.positionOffsets.push_back(static_cast<uint32_t>(out.positions.size()));
+		out.positions.insert(out.positions.end(), list.begin(), list.end());
+	}
+	out.positionOffsets.push_back(static_cast<uint32_t>(out.positions.size()));
+
+	profile.SetBytes((out.tiles.size() + out.frameOffsets.size() + out.frames.size() + out.durations.size())
+		* sizeof(uint16_t) + out.tilesets.size()
+		+ (out.positionOffsets.size() + out.positions.size()) * sizeof(uint32_t));
+}
+
 bool convert::ConvertCollision(std::vector<uint8_t>& out, const TmxReader& tmx)
 {
+	profile::Scope profile("convert::ConvertCollision");
+	size_t numTiles = tmx.TileCount();
+
+	// Synthesise collision from the graphics tiles
+	if (const auto values = tmx.GetCollisionProperty(); values.has_value())
+	{
+		const auto gfxTiles = tmx.GetGraphicsTiles();
+		assert(gfxTiles.size() == numTiles);
+		out.reserve(numTiles);
+		for (const auto tile : gfxTiles)
+		{
+			const double value = tile.id < values->size() ? std::trunc((*values)[tile.id]) : 0.0;
+			if (!(value >= 0.0 && value <= UINT8_MAX))
+				return false;
+			out.emplace_back(static_cast<uint8_t>(value));
+		}
+		profile.SetBytes(out.size());
+		return true;
+	}
+
 	assert(tmx.GetCollisionTiles().has_value());
 	const auto clsTiles = tmx.GetCollisionTiles().value();
 
-	size_t numTiles = tmx.TileCount();
 	assert(clsTiles.size() == numTiles);
 
 	out.reserve(numTiles);
@@ -56,12 +306,812 @@ bool convert::ConvertCollision(std::vector<uint8_t>& out, const TmxReader& tmx)
 		out.emplace_back(id);
 	}
 
+	profile.SetBytes(out.size());
+	return true;
+}
+
+
+bool convert::ArrangeScreenblocks(std::vector<uint16_t>& out, std::span<const uint16_t> charmap,
+	unsigned width, unsigned height)
+{
+	profile::Scope profile("convert::ArrangeScreenblocks");
+	assert(charmap.size() == static_cast<size_t>(width) * height);
+	constexpr unsigned SBB_SIZE = 32;
+
+	const unsigned columns = ScreenblocksFor(width), rows = ScreenblocksFor(height);
+	if (!columns || !rows)
+		return false;
+
+	out.assign(static_cast<size_t>(columns) * rows * SBB_SIZE * SBB_SIZE, 0);
+	for (unsigned y = 0; y < height; ++y)
+	{
+		for (unsigned x = 0; x < width; ++x)
+		{
+			const unsigned sbb = (y / SBB_SIZE) * columns + x / SBB_SIZE;
+			const size_t idx = (static_cast<size_t>(sbb) * SBB_SIZE + y % SBB_SIZE) * SBB_SIZE + x % SBB_SIZE;
+			out[idx] = charmap[static_cast<size_t>(y) * width + x];
+		}
+	}
+
+	profile.SetBytes(out.size() * sizeof(uint16_t));
+	return true;
+}
+
+// Bands of rows large maps are split into for processing in parallel
+static unsigned BandsFor(size_t tiles)
+{
+	constexpr size_t BAND_TILES = 0x10000;
+	return static_cast<unsigned>(std::clamp<size_t>(tiles / BAND_TILES, 1,
+		std::max(std::thread::hardware_concurrency(), 1u)));
+}
+
+static bool SearchFlowField(convert::FlowField& out, bool distances, std::span<const uint8_t> collision,
+	unsigned width, unsigned height, const TmxReader& tmx)
+{
+	using namespace convert;
+	constexpr unsigned TILE_SIZE = 8;
+	const size_t count = collision.size();
+	std::vector<uint16_t> dist(count, FLOW_UNREACHABLE);
+
+	// Seed every walkable tile holding a goal object
+	std::vector<uint32_t> queue;
+	const auto objects = tmx.GetObjects().value();
+	for (const auto& obj : objects)
+	{
+		if (obj.id != out.goal || obj.x < 0.0f || obj.y < 0.0f)
+			continue;
+		const unsigned x = static_cast<unsigned>(obj.x) / TILE_SIZE, y = static_cast<unsigned>(obj.y) / TILE_SIZE;
+		const size_t i = static_cast<size_t>(y) * width + x;
+		if (x >= width || y >= height || collision[i] || dist[i] == 0)
+			continue;
+		dist[i] = 0;
+		queue.emplace_back(static_cast<uint32_t>(i));
+	}
+	if (queue.empty())
+		return false;
+
+	// Multi-source breadth first search, the queue vector doubles as the visit order
+	for (size_t head = 0; head < queue.size(); ++head)
+	{
+		const uint32_t i = queue[head];
+		const unsigned x = i % width, y = i / width;
+		const uint16_t next = static_cast<uint16_t>(std::min(dist[i] + 1, FLOW_UNREACHABLE - 1));
+		auto visit = [&](size_t n)
+		{
+			if (collision[n] || dist[n] != FLOW_UNREACHABLE)
+				return;
+			dist[n] = next;
+			queue.emplace_back(static_cast<uint32_t>(n));
+		};
+		if (y > 0)          visit(i - width);
+		if (x + 1 < width)  visit(i + 1);
+		if (y + 1 < height) visit(i + width);
+		if (x > 0)          visit(i - 1);
+	}
+
+	// Point each tile at its closest neighbour, rows are independent so large maps are split into bands
+	out.stride = (width + 1) / 2;
+	out.directions.assign(static_cast<size_t>(out.stride) * height, 0);
+	auto direct = [&](unsigned firstRow, unsigned lastRow)
+	{
+		for (unsigned y = firstRow; y < lastRow; ++y)
+		{
+			for (unsigned x = 0; x < width; ++x)
+			{
+				const size_t i = static_cast<size_t>(y) * width + x;
+				if (dist[i] == 0 || dist[i] == FLOW_UNREACHABLE)
+					continue;
+				uint8_t dir = FLOW_NONE;
+				uint16_t best = dist[i];
+				auto consider = [&](size_t n, uint8_t d) { if (dist[n] < best) { best = dist[n]; dir = d; } };
+				if (y > 0)          consider(i - width, FLOW_UP);
+				if (x + 1 < width)  consider(i + 1, FLOW_RIGHT);
+				if (y + 1 < height) consider(i + width, FLOW_DOWN);
+				if (x > 0)          consider(i - 1, FLOW_LEFT);
+				out.directions[static_cast<size_t>(y) * out.stride + x / 2] |= static_cast<uint8_t>(dir << (x % 2 * 4));
+			}
+		}
+	};
+
+	const unsigned bands = BandsFor(count);
+	std::vector<std::future<void>> tasks;
+	for (unsigned band = 1; band < bands; ++band)
+		tasks.emplace_back(std::async(std::launch::async, direct, height * band / bands, height * (band + 1) / bands));
+	direct(0, height / bands);
+	for (auto& task : tasks)
+		task.get();
+
+	if (distances)
+		out.distances = std::move(dist);
+	return true;
+}
+
+bool convert::ComputeFlowFields(std::vector<FlowField>& out, uint32_t& failed,
+	std::span<const uint32_t> goals, bool distances, std::span<const uint8_t> collision,
+	unsigned width, unsigned height, const TmxReader& tmx)
+{
+	profile::Scope profile("convert::ComputeFlowFields");
+	assert(tmx.GetObjects().has_value());
+	assert(collision.size() == static_cast<size_t>(width) * height);
+
+	out.clear();
+	std::vector<std::future<bool>> searches;
+	for (uint32_t goal : goals)
+		out.emplace_back(FlowField { goal, 0, {}, {} });
+	for (auto& field : out)
+		searches.emplace_back(std::async(std::launch::async, [&field, distances, collision, width, height, &tmx]
+			{ return SearchFlowField(field, distances, collision, width, height, tmx); }));
+
+	// Wait on every search before failing as they all reference the output
+	bool ok = true;
+	size_t bytes = 0;
+	for (size_t i = 0; i < searches.size(); ++i)
+	{
+		if (!searches[i].get() && ok)
+		{
+			failed = out[i].goal;
+			ok = false;
+		}
+		bytes += out[i].directions.size() + out[i].distances.size() * sizeof(uint16_t);
+	}
+
+	profile.SetBytes(bytes);
+	return ok;
+}
+
+bool convert::FindRegions(RegionGraph& out, std::span<const uint8_t> collision,
+	unsigned width, unsigned height, unsigned cellWidth, unsigned cellHeight)
+{
+	profile::Scope profile("convert::FindRegions");
+	assert(collision.size() == static_cast<size_t>(width) * height);
+	assert(cellWidth && cellHeight);
+	const size_t count = collision.size();
+
+	// Union by smallest index so each root is the first tile of its region
+	std::vector<uint32_t> parent(count);
+	auto find = [&](uint32_t i)
+	{
+		while (parent[i] != i)
+			i = parent[i] = parent[parent[i]];
+		return i;
+	};
+	auto unite = [&](uint32_t a, uint32_t b)
+	{
+		a = find(a);
+		b = find(b);
+		if (a != b)
+			parent[std::max(a, b)] = std::min(a, b);
+	};
+
+	// Bands only ever touch their own tiles so can be united concurrently, then stitched together
+	auto label = [&](unsigned firstRow, unsigned lastRow)
+	{
+		for (unsigned y = firstRow; y < lastRow; ++y)
+		{
+			for (unsigned x = 0; x < width; ++x)
+			{
+				const uint32_t i = y * width + x;
+				parent[i] = i;
+				if (collision[i])
+					continue;
+				if (x > 0 && !collision[i - 1])
+					unite(i, i - 1);
+				if (y > firstRow && !collision[i - width])
+					unite(i, i - width);
+			}
+		}
+	};
+
+	const unsigned bands = BandsFor(count);
+	std::vector<std::future<void>> tasks;
+	for (unsigned band = 1; band < bands; ++band)
+		tasks.emplace_back(std::async(std::launch::async, label, height * band / bands, height * (band + 1) / bands));
+	label(0, height / bands);
+	for (auto& task : tasks)
+		task.get();
+	for (unsigned band = 1; band < bands; ++band)
+	{
+		const unsigned y = height * band / bands;
+		for (unsigned x = 0; x < width; ++x)
+		{
+			const uint32_t i = y * width + x;
+			if (!collision[i] && !collision[i - width])
+				unite(i, i - width);
+		}
+	}
+
+	// Number regions in the order their first tile appears
+	std::vector<uint32_t> regions(count, 0);
+	uint32_t numRegions = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (collision[i])
+			continue;
+		const uint32_t root = find(i);
+		if (root == i)
+			regions[i] = ++numRegions;
+		else
+			regions[i] = regions[root];
+	}
+	if (numRegions > UINT16_MAX)
+		return false;
+
+	out.cellWidth = cellWidth;
+	out.cellHeight = cellHeight;
+	out.columns = std::max(1u, (width + cellWidth - 1) / cellWidth);
+	out.rows = std::max(1u, (height + cellHeight - 1) / cellHeight);
+	out.count = numRegions;
+	out.wide = numRegions > UINT8_MAX;
+	out.map.assign(static_cast<size_t>(out.columns) * out.rows, 0);
+
+	// Distinct regions in each cell, the most common one goes in the map with ties to the lowest ID
+	std::vector<std::vector<uint16_t>> cells(out.map.size());
+	std::vector<uint16_t> cell;
+	for (unsigned cy = 0; cy < out.rows; ++cy)
+	{
+		for (unsigned cx = 0; cx < out.columns; ++cx)
+		{
+			cell.clear();
+			for (unsigned y = cy * cellHeight; y < std::min(height, (cy + 1) * cellHeight); ++y)
+				for (unsigned x = cx * cellWidth; x < std::min(width, (cx + 1) * cellWidth); ++x)
+					if (const uint32_t region = regions[static_cast<size_t>(y) * width + x]; region)
+						cell.emplace_back(static_cast<uint16_t>(region));
+			std::sort(cell.begin(), cell.end());
+
+			const size_t c = static_cast<size_t>(cy) * out.columns + cx;
+			size_t best = 0;
+			for (size_t i = 0, j; i < cell.size(); i = j)
+			{
+				for (j = i; j < cell.size() && cell[j] == cell[i]; ++j) {}
+				if (j - i > best)
+				{
+					best = j - i;
+					out.map[c] = cell[i];
+				}
+				cells[c].emplace_back(cell[i]);
+			}
+		}
+	}
+
+	// Pair up regions sharing a cell or in neighbouring cells
+	std::vector<std::pair<uint16_t, uint16_t>> edges;
+	auto link = [&](const std::vector<uint16_t>& a, const std::vector<uint16_t>& b)
+	{
+		for (uint16_t i : a)
+		{
+			for (uint16_t j : b)
+			{
+				if (i == j)
+					continue;
+				edges.emplace_back(i, j);
+				edges.emplace_back(j, i);
+			}
+		}
+	};
+	for (unsigned cy = 0; cy < out.rows; ++cy)
+	{
+		for (unsigned cx = 0; cx < out.columns; ++cx)
+		{
+			const size_t c = static_cast<size_t>(cy) * out.columns + cx;
+			link(cells[c], cells[c]);
+			if (cx + 1 < out.columns)
+				link(cells[c], cells[c + 1]);
+			if (cy + 1 < out.rows)
+				link(cells[c], cells[c + out.columns]);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	out.offsets.assign(numRegions + 2, 0);
+	out.neighbours.clear();
+	out.neighbours.reserve(edges.size());
+	for (const auto& [from, to] : edges)
+	{
+		++out.offsets[from + 1];
+		out.neighbours.emplace_back(to);
+	}
+	for (size_t i = 1; i < out.offsets.size(); ++i)
+		out.offsets[i] += out.offsets[i - 1];
+
+	profile.SetBytes(out.map.size() * (out.wide ? 2 : 1) + out.offsets.size() * sizeof(uint32_t)
+		+ out.neighbours.size() * (out.wide ? 2 : 1));
+	return true;
+}
+
+void convert::FindCollisionRuns(CollisionRuns& out, std::span<const uint8_t> collision,
+	unsigned width, unsigned height, bool columns)
+{
+	profile::Scope profile("convert::FindCollisionRuns");
+	assert(collision.size() == static_cast<size_t>(width) * height);
+
+	const unsigned lines = columns ? width : height, length = columns ? height : width;
+	assert(length <= 0x10000);
+	auto at = [&](unsigned line, unsigned i)
+	{
+		return columns
+			? collision[static_cast<size_t>(i) * width + line]
+			: collision[static_cast<size_t>(line) * width + i];
+	};
+
+	out.runs.clear();
+	out.offsets.clear();
+	out.offsets.reserve(lines + 1);
+	for (unsigned line = 0; line < lines; ++line)
+	{
+		out.offsets.push_back(static_cast<uint32_t>(out.runs.size() / 2));
+		for (unsigned i = 0; i < length; ++i)
+		{
+			const uint8_t id = at(line, i);
+			if (i && id == at(line, i - 1))
+				continue;
+			out.runs.push_back(static_cast<uint16_t>(i));
+			out.runs.push_back(id);
+		}
+	}
+	out.offsets.push_back(static_cast<uint32_t>(out.runs.size() / 2));
+
+	profile.SetBytes(out.runs.size() * sizeof(uint16_t) + out.offsets.size() * sizeof(uint32_t));
+}
+
+bool convert::PackCollision(std::vector<uint8_t>& out, CollisionBits& info,
+	std::span<const uint8_t> collision, unsigned rowLength, unsigned bits)
+{
+	profile::Scope profile("convert::PackCollision");
+	assert(rowLength && collision.size() % rowLength == 0);
+
+	// Remap the IDs in use to consecutive values, ascending so 0 stays 0 when it's used
+	std::array<bool, 256> used {};
+	for (auto id : collision)
+		used[id] = true;
+	std::array<uint8_t, 256> remap {};
+	info.ids.clear();
+	for (unsigned id = 0; id < used.size(); ++id)
+	{
+		if (!used[id])
+			continue;
+		remap[id] = static_cast<uint8_t>(info.ids.size());
+		info.ids.push_back(static_cast<uint8_t>(id));
+	}
+
+	if (!bits)
+		bits = info.ids.size() <= 2 ? 1 : info.ids.size() <= 4 ? 2 : 4;
+	if (info.ids.size() > (1u << bits))
+		return false;
+	info.bits = bits;
+	info.stride = (rowLength * bits + 7) / 8;
+
+	const size_t rows = collision.size() / rowLength;
+	out.assign(rows * info.stride, 0);
+	for (size_t y = 0; y < rows; ++y)
+	{
+		for (unsigned x = 0; x < rowLength; ++x)
+		{
+			const unsigned bit = x * bits;
+			out[y * info.stride + bit / 8] |= static_cast<uint8_t>(remap[collision[y * rowLength + x]] << (bit % 8));
+		}
+	}
+
+	profile.SetBytes(out.size());
+	return true;
+}
+
+
+template <typename T>
+static void Transpose(std::vector<T>& out, std::span<const T> map, unsigned width, unsigned height)
+{
+	profile::Scope profile("convert::ArrangeColumns");
+	assert(map.size() == static_cast<size_t>(width) * height);
+
+	out.resize(map.size());
+	for (unsigned x = 0; x < width; ++x)
+		for (unsigned y = 0; y < height; ++y)
+			out[static_cast<size_t>(x) * height + y] = map[static_cast<size_t>(y) * width + x];
+
+	profile.SetBytes(out.size() * sizeof(T));
+}
+
+template <typename T>
+static void SplitStrips(std::vector<T>& out, std::span<const T> map, unsigned width, unsigned height)
+{
+	profile::Scope profile("convert::ArrangeStrips");
+	assert(map.size() == static_cast<size_t>(width) * height);
+	constexpr unsigned STRIP_WIDTH = convert::STRIP_WIDTH;
+
+	out.assign(static_cast<size_t>(convert::StripsFor(width)) * STRIP_WIDTH * height, 0);
+	for (unsigned y = 0; y < height; ++y)
+	{
+		for (unsigned x = 0; x < width; ++x)
+		{
+			const size_t idx = (static_cast<size_t>(x / STRIP_WIDTH) * height + y) * STRIP_WIDTH + x % STRIP_WIDTH;
+			out[idx] = map[static_cast<size_t>(y) * width + x];
+		}
+	}
+
+	profile.SetBytes(out.size() * sizeof(T));
+}
+
+void convert::ArrangeColumns(std::vector<uint16_t>& out, std::span<const uint16_t> map, unsigned width, unsigned height)
+{
+	Transpose(out, map, width, height);
+}
+
+void convert::ArrangeColumns(std::vector<uint8_t>& out, std::span<const uint8_t> map, unsigned width, unsigned height)
+{
+	Transpose(out, map, width, height);
+}
+
+void convert::ArrangeStrips(std::vector<uint16_t>& out, std::span<const uint16_t> map, unsigned width, unsigned height)
+{
+	SplitStrips(out, map, width, height);
+}
+
+void convert::ArrangeStrips(std::vector<uint8_t>& out, std::span<const uint8_t> map, unsigned width, unsigned height)
+{
+	SplitStrips(out, map, width, height);
+}
+
+
+static unsigned PropertySize(convert::PropertyType type)
+{
+	switch (type)
+	{
+	case convert::PropertyType::U8:    return 1;
+	case convert::PropertyType::U16:
+	case convert::PropertyType::S16:   return 2;
+	case convert::PropertyType::U32:
+	case convert::PropertyType::FIXED: return 4;
+	}
+	return 4;
+}
+
+bool convert::IsIdentifier(const std::string_view name)
+{
+	return !name.empty() && !std::isdigit(static_cast<unsigned char>(name.front()))
+		&& std::all_of(name.begin(), name.end(), [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; });
+}
+
+bool convert::AddPropertyField(PropertySchema& schema, const std::string_view field)
+{
+	const auto splitter = field.find(':');
+	if (splitter == std::string_view::npos)
+		return false;
+	const auto name = field.substr(0, splitter), type = field.substr(splitter + 1);
+	if (!IsIdentifier(name))
+		return false;
+	// Names differing only in the case of their first letter would still give the same offset define
+	auto sameDefine = [name](const PropertyField& f)
+	{
+		auto upper = [](char c) { return std::toupper(static_cast<unsigned char>(c)); };
+		return f.name.size() == name.size() && f.name.substr(1) == name.substr(1)
+			&& upper(f.name.front()) == upper(name.front());
+	};
+	if (std::any_of(schema.fields.begin(), schema.fields.end(), sameDefine))
+		return false;
+
+	PropertyField out { std::string(name), {}, 0 };
+	if (type == "u8")         out.type = PropertyType::U8;
+	else if (type == "u16")   out.type = PropertyType::U16;
+	else if (type == "s16")   out.type = PropertyType::S16;
+	else if (type == "u32")   out.type = PropertyType::U32;
+	else if (type == "fixed") out.type = PropertyType::FIXED;
+	else
+		return false;
+
+	// Pack after the last field rather than the padded end of the record
+	const unsigned size = PropertySize(out.type);
+	const unsigned end = schema.fields.empty() ? 0
+		: schema.fields.back().offset + PropertySize(schema.fields.back().type);
+	out.offset = (end + size - 1) / size * size;
+	schema.align = std::max(schema.align, size);
+	schema.size = (out.offset + size + schema.align - 1) / schema.align * schema.align;
+	schema.fields.emplace_back(std::move(out));
+	return true;
+}
+
+convert::PropertyError convert::PackObjectProperties(ObjectRecords& out, std::string& failed,
+	const PropertySchema& schema, const TmxReader& tmx)
+{
+	profile::Scope profile("convert::PackObjectProperties");
+	assert(tmx.GetObjects().has_value());
+	const auto objects = tmx.GetObjects().value();
+
+	out.size = schema.size;
+	out.data.assign(objects.size() * schema.size, 0);
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		const auto& values = objects[i].properties;
+		assert(values.size() == schema.fields.size());
+		for (size_t f = 0; f < schema.fields.size(); ++f)
+		{
+			const auto& field = schema.fields[f];
+			double value = values[f];
+			if (std::isnan(value))
+			{
+				failed = field.name;
+				return PropertyError::NOT_A_NUMBER;
+			}
+
+			double min = 0.0, max = UINT32_MAX;
+			switch (field.type)
+			{
+			case PropertyType::U8:  max = UINT8_MAX; break;
+			case PropertyType::U16: max = UINT16_MAX; break;
+			case PropertyType::S16: min = INT16_MIN; max = INT16_MAX; break;
+			case PropertyType::U32: break;
+			case PropertyType::FIXED:
+				value *= 256.0;
+				min = INT32_MIN; max = INT32_MAX;
+				break;
+			}
+			value = std::trunc(value);
+			if (value < min || value > max)
+			{
+				failed = field.name;
+				return PropertyError::OUT_OF_RANGE;
+			}
+
+			// Records are little endian like the GBA
+			const auto bits = static_cast<uint32_t>(static_cast<int64_t>(value));
+			for (unsigned b = 0; b < PropertySize(field.type); ++b)
+				out.data[i * schema.size + field.offset + b] = static_cast<uint8_t>(bits >> (b * 8));
+		}
+	}
+
+	profile.SetBytes(out.data.size());
+	return PropertyError::OK;
+}
+
+
+// Reorders objects & their records so that destination i holds source order[i]
+static void Permute(std::vector<uint32_t>& objects, convert::ObjectRecords* records, std::span<const size_t> order)
+{
+	std::vector<uint32_t> sorted(objects.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		std::copy_n(objects.begin() + order[i] * 3, 3, sorted.begin() + i * 3);
+	objects = std::move(sorted);
+
+	if (!records)
+		return;
+	std::vector<uint8_t> sortedRecords(records->data.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		std::copy_n(records->data.begin() + order[i] * records->size, records->size,
+			sortedRecords.begin() + i * records->size);
+	records->data = std::move(sortedRecords);
+}
+
+void convert::GroupObjects(std::vector<uint32_t>& objects, std::vector<ObjectGroup>& groups,
+	ObjectRecords* records)
+{
+	profile::Scope profile("convert::GroupObjects");
+	assert(objects.size() % 3 == 0);
+
+	const size_t numObjects = objects.size() / 3;
+	std::vector<size_t> order(numObjects);
+	for (size_t i = 0; i < numObjects; ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r)
+	{
+		return objects[l * 3] < objects[r * 3];
+	});
+	Permute(objects, records, order);
+
+	groups.clear();
+	for (size_t i = 0; i < numObjects; ++i)
+	{
+		const uint32_t id = objects[i * 3];
+		if (groups.empty() || groups.back().id != id)
+			groups.push_back({ id, static_cast<uint32_t>(i), 0 });
+		++groups.back().count;
+	}
+
+	profile.SetBytes(objects.size() * sizeof(uint32_t));
+}
+
+bool convert::SplitObjects(ObjectArrays& out, std::span<const uint32_t> objects, bool pixels)
+{
+	profile::Scope profile("convert::SplitObjects");
+	assert(objects.size() % 3 == 0);
+
+	const size_t numObjects = objects.size() / 3;
+	out = {};
+	out.ids.reserve(numObjects);
+	for (size_t i = 0; i < numObjects; ++i)
+	{
+		out.ids.push_back(objects[i * 3]);
+		if (!pixels)
+		{
+			out.x.push_back(objects[i * 3 + 1]);
+			out.y.push_back(objects[i * 3 + 2]);
+			continue;
+		}
+		// Drop the fraction of the signed 24.8 fixed point position
+		const int x = static_cast<int>(objects[i * 3 + 1]) >> 8, y = static_cast<int>(objects[i * 3 + 2]) >> 8;
+		if (x < INT16_MIN || x > INT16_MAX || y < INT16_MIN || y > INT16_MAX)
+			return false;
+		out.x16.push_back(static_cast<int16_t>(x));
+		out.y16.push_back(static_cast<int16_t>(y));
+	}
+
+	profile.SetBytes(out.ids.size() * sizeof(uint32_t)
+		+ (out.x.size() + out.y.size()) * sizeof(uint32_t)
+		+ (out.x16.size() + out.y16.size()) * sizeof(int16_t));
+	return true;
+}
+
+void convert::SortObjectsByX(std::vector<uint32_t>& objects, ObjectColumns& columns,
+	unsigned mapWidth, unsigned columnWidth, ObjectRecords* records)
+{
+	profile::Scope profile("convert::SortObjectsByX");
+	assert(objects.size() % 3 == 0);
+	assert(columnWidth);
+	constexpr unsigned TILE_SIZE = 8;
+
+	// Positions are signed 24.8 fixed point
+	const size_t numObjects = objects.size() / 3;
+	auto x = [&](size_t i) { return static_cast<int>(objects[i * 3 + 1]); };
+	auto y = [&](size_t i) { return static_cast<int>(objects[i * 3 + 2]); };
+	std::vector<size_t> order(numObjects);
+	for (size_t i = 0; i < numObjects; ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r)
+	{
+		return std::make_pair(x(l), y(l)) < std::make_pair(x(r), y(r));
+	});
+	Permute(objects, records, order);
+
+	const unsigned count = std::max(1u, (mapWidth * TILE_SIZE + columnWidth - 1) / columnWidth);
+	auto& index = columns.index;
+	columns.width = columnWidth;
+	index.resize(count + 1);
+	// Objects left of the map belong to the first column
+	size_t next = 0;
+	index[0] = 0;
+	for (unsigned column = 1; column < count; ++column)
+	{
+		const int start = static_cast<int>(column * columnWidth) << 8;
+		while (next < numObjects && x(next) < start)
+			++next;
+		index[column] = static_cast<uint32_t>(next);
+	}
+	index[count] = static_cast<uint32_t>(numObjects);
+
+	profile.SetBytes(objects.size() * sizeof(uint32_t) + index.size() * sizeof(uint32_t));
+}
+
+void convert::BucketObjects(std::vector<uint32_t>& objects, ObjectGrid& grid, unsigned mapWidth, unsigned mapHeight,
+	unsigned cellWidth, unsigned cellHeight, ObjectRecords* records)
+{
+	profile::Scope profile("convert::BucketObjects");
+	assert(objects.size() % 3 == 0);
+	assert(cellWidth && cellHeight);
+	constexpr unsigned TILE_SIZE = 8;
+
+	grid.cellWidth = cellWidth;
+	grid.cellHeight = cellHeight;
+	grid.columns = std::max(1u, (mapWidth * TILE_SIZE + cellWidth - 1) / cellWidth);
+	grid.rows = std::max(1u, (mapHeight * TILE_SIZE + cellHeight - 1) / cellHeight);
+
+	// Positions are signed 24.8 fixed point
+	auto cell = [&](int fixed, unsigned size, unsigned count)
+	{
+		return std::min(static_cast<unsigned>(std::max(0, fixed >> 8)) / size, count - 1);
+	};
+
+	const size_t count = objects.size() / 3;
+	std::vector<unsigned> cells(count);
+	grid.offsets.assign(static_cast<size_t>(grid.columns) * grid.rows + 1, 0);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const unsigned x = cell(static_cast<int>(objects[i * 3 + 1]), cellWidth, grid.columns);
+		const unsigned y = cell(static_cast<int>(objects[i * 3 + 2]), cellHeight, grid.rows);
+		cells[i] = y * grid.columns + x;
+		++grid.offsets[cells[i] + 1];
+	}
+	// Counting sort keeps objects stable within each cell
+	for (size_t i = 1; i < grid.offsets.size(); ++i)
+		grid.offsets[i] += grid.offsets[i - 1];
+	std::vector<size_t> order(count);
+	std::vector<uint32_t> next(grid.offsets.begin(), grid.offsets.end() - 1);
+	for (size_t i = 0; i < count; ++i)
+		order[next[cells[i]]++] = i;
+	Permute(objects, records, order);
+
+	profile.SetBytes(objects.size() * sizeof(uint32_t) + grid.offsets.size() * sizeof(uint32_t));
+}
+
+
+bool convert::ExtractMetatiles(Metatiles& out, std::span<const uint16_t> charmap,
+	unsigned mapWidth, unsigned mapHeight, unsigned width, unsigned height, bool flips)
+{
+	profile::Scope profile("convert::ExtractMetatiles");
+	assert(charmap.size() == static_cast<size_t>(mapWidth) * mapHeight);
+	assert(width && height);
+	constexpr uint16_t FLIP_BITS = METATILE_FLIP_HORZ | METATILE_FLIP_VERT;
+	// Flip bits share the entry with the index so limit how many can be addressed
+	const size_t maxCount = flips ? METATILE_FLIP_HORZ : 0x10000;
+
+	out.width = width;
+	out.height = height;
+	out.columns = (mapWidth + width - 1) / width;
+	out.rows = (mapHeight + height - 1) / height;
+	out.dictionary.clear();
+	out.map.clear();
+	out.map.reserve(static_cast<size_t>(out.columns) * out.rows);
+
+	// Hashing whole blocks keeps lookups constant time on huge maps
+	std::unordered_map<std::u16string, uint16_t> known;
+	std::u16string block(static_cast<size_t>(width) * height, 0);
+	std::u16string variant(block.size(), 0);
+
+	// Mirror a block & toggle the flip bits of each entry to match
+	auto mirror = [&](uint16_t flip)
+	{
+		for (unsigned y = 0; y < height; ++y)
+		{
+			const unsigned srcY = (flip & METATILE_FLIP_VERT) ? height - 1 - y : y;
+			for (unsigned x = 0; x < width; ++x)
+			{
+				const unsigned srcX = (flip & METATILE_FLIP_HORZ) ? width - 1 - x : x;
+				variant[static_cast<size_t>(y) * width + x] = block[static_cast<size_t>(srcY) * width + srcX] ^ flip;
+			}
+		}
+	};
+
+	for (unsigned row = 0; row < out.rows; ++row)
+	{
+		for (unsigned col = 0; col < out.columns; ++col)
+		{
+			for (unsigned y = 0; y < height; ++y)
+			{
+				const unsigned mapY = row * height + y;
+				for (unsigned x = 0; x < width; ++x)
+				{
+					const unsigned mapX = col * width + x;
+					block[static_cast<size_t>(y) * width + x] = mapX < mapWidth && mapY < mapHeight
+						? charmap[static_cast<size_t>(mapY) * mapWidth + mapX] : 0;
+				}
+			}
+
+			if (auto it = known.find(block); it != known.end())
+			{
+				out.map.push_back(it->second);
+				continue;
+			}
+			if (flips)
+			{
+				bool found = false;
+				for (uint16_t flip : { METATILE_FLIP_HORZ, METATILE_FLIP_VERT, FLIP_BITS })
+				{
+					mirror(flip);
+					if (auto it = known.find(variant); it != known.end())
+					{
+						out.map.push_back(it->second | flip);
+						found = true;
+						break;
+					}
+				}
+				if (found)
+					continue;
+			}
+
+			const size_t index = known.size();
+			if (index >= maxCount)
+				return false;
+			known.emplace(block, static_cast<uint16_t>(index));
+			out.dictionary.insert(out.dictionary.end(), block.begin(), block.end());
+			out.map.push_back(static_cast<uint16_t>(index));
+		}
+	}
+
+	profile.SetBytes((out.dictionary.size() + out.map.size()) * sizeof(uint16_t));
 	return true;
 }
 
 
 bool convert::ConvertObjects(std::vector<uint32_t>& out, const TmxReader& tmx)
 {
+	profile::Scope profile("convert::ConvertObjects");
 	assert(tmx.GetObjects().has_value());
 	const auto objects = tmx.GetObjects().value();
 
@@ -72,5 +1122,6 @@ bool convert::ConvertObjects(std::vector<uint32_t>& out, const TmxReader& tmx)
 		out.emplace_back(static_cast<int>(obj.y * 256.0f));
 	}
 
+	profile.SetBytes(out.size() * sizeof(uint32_t));
 	return true;
 }
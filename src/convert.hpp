@@ -4,6 +4,9 @@
 #define CONVERT_HPP
 
 #include <cstdint>
+#include <string>
+#include <string_view>
+#include <span>
 #include <vector>
 
 class TmxReader;
@@ -13,8 +16,285 @@ namespace convert
 	[[nodiscard]] bool ConvertCharmap(std::vector<uint16_t>& out,
 		int idOffset, uint32_t defaultPalIdx,
 		const TmxReader& tmx);
+	// Fails if collision comes from a tile property that isn't a whole number from 0 to 255
 	[[nodiscard]] bool ConvertCollision(std::vector<uint8_t>& out, const TmxReader& tmx);
 	[[nodiscard]] bool ConvertObjects(std::vector<uint32_t>& out, const TmxReader& tmx);
+
+	// Tile collision shapes rasterised to 8x8 pixels for one tileset indexed by tile index (LID plus offset),
+	//  8 bytes per tile each, masks are a byte per row with bit x set for a solid pixel (a little endian
+	//  64-bit word per tile), heights are a byte per column giving how far up from the bottom it's solid
+	struct TileMasks
+	{
+		unsigned tileset;
+		std::vector<uint8_t> masks, heights;
+	};
+
+	void ConvertTileMasks(std::vector<TileMasks>& out, bool masks, bool heights, int idxOffset, const TmxReader& tmx);
+
+	// Tile animations in GID order, each animation's frames & positions are the ranges between consecutive
+	//  offsets, positions are charmap indices of the row-major map
+	struct Animations
+	{
+		std::vector<uint16_t> tiles;      // Tile index of the animated tile itself
+		std::vector<uint8_t> tilesets;    // Tileset the animation comes from
+		std::vector<uint16_t> frameOffsets, frames, durations;
+		std::vector<uint32_t> positionOffsets, positions;
+	};
+
+	// Durations are converted from milliseconds to ticks of the 59.73 Hz refresh rate, at least 1 each
+	void ConvertAnimations(Animations& out, int idxOffset, const TmxReader& tmx);
+
+	enum class PropertyType
+	{
+		U8,
+		U16,
+		S16,
+		U32,
+		FIXED  // Signed 24.8 fixed point
+	};
+
+	struct PropertyField
+	{
+		std::string name;
+		PropertyType type;
+		unsigned offset;  // Byte offset into a record
+	};
+
+	// Fields are stored in order, each aligned to its size, records are padded to the largest alignment
+	struct PropertySchema
+	{
+		std::vector<PropertyField> fields;
+		unsigned size = 0, align = 1;
+	};
+
+	[[nodiscard]] bool IsIdentifier(const std::string_view name);
+
+	// Parses "name:type" & appends it to the schema, names must be valid C identifiers not already in it
+	[[nodiscard]] bool AddPropertyField(PropertySchema& schema, const std::string_view field);
+
+	// One fixed size record of object properties per object, in the same order as the objects
+	struct ObjectRecords
+	{
+		unsigned size;
+		std::vector<uint8_t> data;
+	};
+
+	enum class PropertyError
+	{
+		OK,
+		NOT_A_NUMBER,
+		OUT_OF_RANGE
+	};
+
+	// Objects must have been read with the names of the schema fields, failed names the offending field
+	[[nodiscard]] PropertyError PackObjectProperties(ObjectRecords& out, std::string& failed,
+		const PropertySchema& schema, const TmxReader& tmx);
+
+	// Lookup table of a tile property for one tileset indexed by tile index (LID plus offset),
+	//  tiles without the property are 0
+	struct TileLut
+	{
+		unsigned property, tileset;
+		bool wide;  // Values need 16 bits
+		std::vector<uint16_t> values;
+	};
+
+	// Properties are unsigned 8 or 16-bit, failed names the offending property
+	[[nodiscard]] PropertyError ConvertTileProperties(std::vector<TileLut>& out, std::string& failed,
+		std::span<const std::string> names, int idxOffset, const TmxReader& tmx);
+
+	// Contiguous range of objects sharing an ID
+	struct ObjectGroup
+	{
+		uint32_t id;
+		uint32_t first, count;
+	};
+
+	// Object reordering also reorders their property records when given
+	// Sorts converted objects by ID, keeping document order within each group
+	void GroupObjects(std::vector<uint32_t>& objects, std::vector<ObjectGroup>& groups,
+		ObjectRecords* records = nullptr);
+
+	// Converted objects split into one array per field, positions are either 24.8 fixed point
+	//  or whole pixels as signed 16-bit
+	struct ObjectArrays
+	{
+		std::vector<uint32_t> ids;
+		std::vector<uint32_t> x, y;
+		std::vector<int16_t> x16, y16;
+	};
+
+	// Fails if a position doesn't fit in 16 bits when converting to pixels
+	[[nodiscard]] bool SplitObjects(ObjectArrays& out, std::span<const uint32_t> objects, bool pixels);
+
+	// Index of the first object at or right of the start of each column of the map plus one for the end,
+	//  the first column also holds objects left of the map
+	struct ObjectColumns
+	{
+		unsigned width;  // In pixels
+		std::vector<uint32_t> index;
+	};
+
+	// Sorts converted objects by x then y so a cursor can follow the camera
+	void SortObjectsByX(std::vector<uint32_t>& objects, ObjectColumns& columns,
+		unsigned mapWidth, unsigned columnWidth, ObjectRecords* records = nullptr);
+
+	// Uniform grid of cells covering the map, offsets has the index of the first object in each cell
+	//  in row-major order plus one for the end
+	struct ObjectGrid
+	{
+		unsigned cellWidth, cellHeight;  // In pixels
+		unsigned columns, rows;
+		std::vector<uint32_t> offsets;
+	};
+
+	// Reorders converted objects so those in the same cell are contiguous, keeping their document order
+	//  within a cell, objects outside of the map go in the nearest cell on the edge
+	void BucketObjects(std::vector<uint32_t>& objects, ObjectGrid& grid, unsigned mapWidth, unsigned mapHeight,
+		unsigned cellWidth, unsigned cellHeight, ObjectRecords* records = nullptr);
+
+	// Collision runs of each row or column, runs are pairs of start & collision ID in ascending order
+	//  so a line can be binary searched, offsets has a run index for each line plus one for the end
+	struct CollisionRuns
+	{
+		std::vector<uint16_t> runs;
+		std::vector<uint32_t> offsets;
+	};
+
+	void FindCollisionRuns(CollisionRuns& out, std::span<const uint8_t> collision,
+		unsigned width, unsigned height, bool columns);
+
+	// Flow field directions towards a neighbouring tile one step closer to the nearest goal, FLOW_NONE
+	//  for goals, solid & unreachable tiles
+	inline constexpr uint8_t FLOW_NONE  = 0;
+	inline constexpr uint8_t FLOW_UP    = 1;
+	inline constexpr uint8_t FLOW_RIGHT = 2;
+	inline constexpr uint8_t FLOW_DOWN  = 3;
+	inline constexpr uint8_t FLOW_LEFT  = 4;
+	// Distance of solid & unreachable tiles, longer distances saturate one below
+	inline constexpr uint16_t FLOW_UNREACHABLE = 0xFFFF;
+
+	// Row-major field over the walkable (collision ID 0) tiles towards the objects with the goal ID,
+	//  directions are packed two to a byte with the first tile in the low nibble, rows byte aligned
+	struct FlowField
+	{
+		uint32_t goal;
+		unsigned stride;  // Bytes per row of directions
+		std::vector<uint8_t> directions;
+		std::vector<uint16_t> distances;  // Steps to the nearest goal, empty unless requested
+	};
+
+	// Each goal ID is searched concurrently, fails naming the goal if no object with it lies on a walkable tile
+	[[nodiscard]] bool ComputeFlowFields(std::vector<FlowField>& out, uint32_t& failed,
+		std::span<const uint32_t> goals, bool distances, std::span<const uint8_t> collision,
+		unsigned width, unsigned height, const TmxReader& tmx);
+
+	// Connected regions of walkable (collision ID 0) tiles numbered from 1 in order of their first tile,
+	//  map has the region covering the most of each cell in row-major order or 0 for none, regions are
+	//  neighbours when they share or occupy 4-adjacent cells, listed in ascending order for each region
+	//  between consecutive offsets, indexed by region ID so region 0 has an empty list
+	struct RegionGraph
+	{
+		unsigned cellWidth, cellHeight;  // In tiles
+		unsigned columns, rows;
+		unsigned count;
+		bool wide;  // Region IDs need 16 bits
+		std::vector<uint16_t> map;
+		std::vector<uint32_t> offsets;
+		std::vector<uint16_t> neighbours;
+	};
+
+	// Labels regions with a union-find over bands of rows in parallel, fails if there are more than 65535
+	[[nodiscard]] bool FindRegions(RegionGraph& out, std::span<const uint8_t> collision,
+		unsigned width, unsigned height, unsigned cellWidth, unsigned cellHeight);
+
+	// Collision packed several tiles to a byte, values index a table of the collision IDs actually used
+	struct CollisionBits
+	{
+		unsigned bits;             // 1, 2 or 4 bits per tile
+		unsigned stride;           // Bytes per row, rows start on a byte boundary
+		std::vector<uint8_t> ids;  // Original collision ID of each packed value
+	};
+
+	// Packs rows of rowLength tiles with the first tile in the low bits of each byte, a bits of 0 picks
+	//  the narrowest that fits, fails if the IDs used don't fit in the requested or any packed width
+	[[nodiscard]] bool PackCollision(std::vector<uint8_t>& out, CollisionBits& info,
+		std::span<const uint8_t> collision, unsigned rowLength, unsigned bits);
+
+	enum class AffineError
+	{
+		OK,
+		TOO_LARGE,
+		INDEX_RANGE,
+		FLIPPED
+	};
+
+	// Side length of the smallest affine background a map fits, 0 if it's bigger than 128 tiles
+	[[nodiscard]] constexpr unsigned AffineSizeFor(unsigned tiles)
+	{
+		for (unsigned size = 16; size <= 128; size *= 2)
+			if (tiles <= size)
+				return size;
+		return 0;
+	}
+
+	// Affine backgrounds are square with 8-bit tile indices & no flip or palette bits,
+	//  maps are padded out to the nearest affine size with zeroes
+	[[nodiscard]] AffineError ConvertAffine(std::vector<uint8_t>& out, int idxOffset, const TmxReader& tmx);
+
+	enum class Layout
+	{
+		ROW_MAJOR,
+		SCREENBLOCKS,
+		COLUMN_MAJOR,
+		STRIPS
+	};
+
+	// Width in tiles of the row strips vertical scrollers stream from, the width of a screenblock
+	inline constexpr unsigned STRIP_WIDTH = 32;
+
+	[[nodiscard]] constexpr unsigned StripsFor(unsigned width)
+	{
+		return (width + STRIP_WIDTH - 1) / STRIP_WIDTH;
+	}
+
+	// Screenblocks across or down a regular background that fits a map dimension, 0 if none can
+	[[nodiscard]] constexpr unsigned ScreenblocksFor(unsigned tiles)
+	{
+		return tiles <= 32 ? 1 : tiles <= 64 ? 2 : 0;
+	}
+
+	// Rearranges a row-major charmap into consecutive 32x32 screenblocks in the order the hardware
+	//  expects for 32x32, 64x32, 32x64 or 64x64 backgrounds, padding the map out with zeroes
+	[[nodiscard]] bool ArrangeScreenblocks(std::vector<uint16_t>& out, std::span<const uint16_t> charmap,
+		unsigned width, unsigned height);
+
+	// Transposes a row-major map so each column is contiguous for horizontal scrollers
+	void ArrangeColumns(std::vector<uint16_t>& out, std::span<const uint16_t> map, unsigned width, unsigned height);
+	void ArrangeColumns(std::vector<uint8_t>& out, std::span<const uint8_t> map, unsigned width, unsigned height);
+
+	// Splits a row-major map into consecutive STRIP_WIDTH wide strips, each row-major, so a row of the
+	//  strip on screen is contiguous for vertical scrollers, padding the last strip out with zeroes
+	void ArrangeStrips(std::vector<uint16_t>& out, std::span<const uint16_t> map, unsigned width, unsigned height);
+	void ArrangeStrips(std::vector<uint8_t>& out, std::span<const uint8_t> map, unsigned width, unsigned height);
+
+	// Flip bits of metatile map entries when flipped variants are matched, same place as in charmap entries
+	inline constexpr uint16_t METATILE_FLIP_HORZ = 0x0400;
+	inline constexpr uint16_t METATILE_FLIP_VERT = 0x0800;
+
+	// Charmap split into blocks of WxH tiles, each distinct block is stored once in the dictionary
+	struct Metatiles
+	{
+		unsigned width, height;      // Size of a metatile in charmap entries
+		unsigned columns, rows;      // Size of the metatile map
+		std::vector<uint16_t> dictionary;  // Charmap entries of each unique metatile in row-major order
+		std::vector<uint16_t> map;         // Dictionary index of every block, plus flip bits if enabled
+	};
+
+	// Blocks overhanging the right or bottom edge of the map are padded with zeroes, with flips enabled
+	//  blocks matching a mirrored metatile reuse it, fails if there are too many unique metatiles to index
+	[[nodiscard]] bool ExtractMetatiles(Metatiles& out, std::span<const uint16_t> charmap,
+		unsigned mapWidth, unsigned mapHeight, unsigned width, unsigned height, bool flips);
 };
 
 #endif//CONVERT_HPP
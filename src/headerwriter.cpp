@@ -2,13 +2,28 @@
 
 #include "headerwriter.hpp"
 #include <algorithm>
+#include <bit>
 
 
 template <typename T> static constexpr std::string_view DatType();
 template <> constexpr std::string_view DatType<uint8_t>() { return "unsigned char"; }
 template <> constexpr std::string_view DatType<uint16_t>() { return "unsigned short"; }
+template <> constexpr std::string_view DatType<int16_t>()  { return "signed short"; }
 template <> constexpr std::string_view DatType<uint32_t>() { return "unsigned int"; }
 
+static std::string HexByte(uint8_t x)
+{
+	return { '0', 'x', "0123456789ABCDEF"[x >> 4], "0123456789ABCDEF"[x & 0xF] };
+}
+
+static std::string Capitalise(const std::string_view name)
+{
+	std::string out(name);
+	if (!out.empty())
+		out.front() = static_cast<char>(std::toupper(static_cast<unsigned char>(out.front())));
+	return out;
+}
+
 void HeaderWriter::WriteSize(unsigned width, unsigned height)
 {
 	stream << std::endl;
@@ -16,26 +31,248 @@ void HeaderWriter::WriteSize(unsigned width, unsigned height)
 	WriteDefine(mName + "Height", height);
 }
 
-void HeaderWriter::WriteCharacterMap(const std::span<uint16_t> charData)
+template <typename T>
+void HeaderWriter::WriteArraySymbol(const std::string_view suffix, std::size_t count, const compress::Packed* packed)
+{
+	const std::string name = mName + std::string(suffix);
+	if (!packed)
+	{
+		WriteSymbol(name, DatType<T>(), count);
+		return;
+	}
+	// BIOS type bytes tell loaders which decompressor & unfilter to use
+	WriteDefine(name + "Codec", HexByte(compress::CodecType(packed->codec)));
+	WriteDefine(name + "Filter", HexByte(compress::FilterType(packed->filter)));
+	WriteDefine(name + "CompLen", packed->data.size());
+	WriteSymbol(name, DatType<uint8_t>(), packed->data.size());
+}
+
+void HeaderWriter::WriteScreenblocks(unsigned columns, unsigned rows)
+{
+	WriteDefine(mName + "SbbCount", columns * rows);
+	// Value of the size field in BGxCNT
+	WriteDefine(mName + "BgSize", (columns > 1 ? 1 : 0) | (rows > 1 ? 2 : 0));
+}
+
+void HeaderWriter::WriteColumns(unsigned height)
+{
+	// Entries between the start of one column & the next
+	WriteDefine(mName + "ColumnStride", height);
+}
+
+void HeaderWriter::WriteStrips(unsigned count, unsigned width, unsigned height)
+{
+	WriteDefine(mName + "StripCount", count);
+	WriteDefine(mName + "StripWidth", width);
+	// Entries between the start of one strip & the next
+	WriteDefine(mName + "StripStride", width * height);
+}
+
+void HeaderWriter::WriteCharacterMap(const std::span<uint16_t> charData, const compress::Packed* packed)
+{
+	stream << std::endl;
+	WriteDefine(mName + "TilesLen", charData.size() * 2);
+	WriteArraySymbol<uint16_t>("Tiles", charData.size(), packed);
+}
+
+void HeaderWriter::WriteCharacterMap(const std::span<uint16_t> charData, const compress::Regions& regions)
 {
 	stream << std::endl;
 	WriteDefine(mName + "TilesLen", charData.size() * 2);
-	WriteSymbol(mName + "Tiles", DatType<uint16_t>(), charData.size());
+	WriteDefine(mName + "TilesCodec", HexByte(compress::CodecType(regions.codec)));
+	WriteDefine(mName + "TilesFilter", HexByte(compress::FilterType(regions.filter)));
+	WriteDefine(mName + "TilesCompLen", regions.data.size());
+	WriteDefine(mName + "TilesRegionWidth", regions.width);
+	WriteDefine(mName + "TilesRegionHeight", regions.height);
+	WriteDefine(mName + "TilesRegionLen", regions.width * regions.height * 2);
+	WriteDefine(mName + "TilesRegionsX", regions.columns);
+	WriteDefine(mName + "TilesRegionsY", regions.rows);
+	WriteDefine(mName + "TilesRegionCount", regions.unique);
+	WriteSymbol(mName + "Tiles", DatType<uint8_t>(), regions.data.size());
+	WriteSymbol(mName + "TilesOffsets", DatType<uint32_t>(), regions.offsets.size());
+}
+
+void HeaderWriter::WriteMetatiles(const convert::Metatiles& metatiles,
+	const compress::Packed* dictPacked, const compress::Packed* mapPacked)
+{
+	stream << std::endl;
+	WriteDefine(mName + "MetatileWidth", metatiles.width);
+	WriteDefine(mName + "MetatileHeight", metatiles.height);
+	WriteDefine(mName + "MetatileCount", metatiles.dictionary.size() / (metatiles.width * metatiles.height));
+	WriteDefine(mName + "MetatilesLen", metatiles.dictionary.size() * 2);
+	WriteArraySymbol<uint16_t>("Metatiles", metatiles.dictionary.size(), dictPacked);
+	WriteDefine(mName + "MetatileMapWidth", metatiles.columns);
+	WriteDefine(mName + "MetatileMapHeight", metatiles.rows);
+	WriteDefine(mName + "MetatileMapLen", metatiles.map.size() * 2);
+	WriteArraySymbol<uint16_t>("MetatileMap", metatiles.map.size(), mapPacked);
+}
+
+void HeaderWriter::WriteAffineMap(const std::span<uint8_t> affineData, unsigned size, const compress::Packed* packed)
+{
+	stream << std::endl;
+	WriteDefine(mName + "AffineSize", size);
+	// Value of the size field in BGxCNT for affine backgrounds
+	WriteDefine(mName + "BgSize", std::countr_zero(size / 16));
+	WriteDefine(mName + "TilesLen", affineData.size());
+	WriteArraySymbol<uint8_t>("Tiles", affineData.size(), packed);
 }
 
-void HeaderWriter::WriteCollision(const std::span<uint8_t> collisionData)
+void HeaderWriter::WriteCollision(const std::span<uint8_t> collisionData, const compress::Packed* packed)
 {
 	stream << std::endl;
 	WriteDefine(mName + "CollisionLen", collisionData.size());
-	WriteSymbol(mName + "Collision", DatType<uint8_t>(), collisionData.size());
+	WriteArraySymbol<uint8_t>("Collision", collisionData.size(), packed);
 }
 
-void HeaderWriter::WriteObjects(const std::span<uint32_t> objData)
+void HeaderWriter::WriteCollisionBits(const convert::CollisionBits& info)
+{
+	WriteDefine(mName + "CollisionBits", info.bits);
+	WriteDefine(mName + "CollisionStride", info.stride);
+	WriteDefine(mName + "CollisionIdCount", info.ids.size());
+	WriteSymbol(mName + "CollisionIds", DatType<uint8_t>(), info.ids.size());
+}
+
+void HeaderWriter::WriteCollisionRuns(const std::string_view lines, const convert::CollisionRuns& runs)
+{
+	const std::string name = mName + "Collision" + std::string(lines);
+	WriteDefine(name + "RunCount", runs.runs.size() / 2);
+	WriteSymbol(name + "Runs", DatType<uint16_t>(), runs.runs.size());
+	WriteSymbol(name + "Offsets", DatType<uint32_t>(), runs.offsets.size());
+}
+
+void HeaderWriter::WriteObjects(const std::span<uint32_t> objData, const compress::Packed* packed)
 {
 	stream << std::endl;
 	WriteDefine(mName + "ObjCount", objData.size() / 3);
 	WriteDefine(mName + "ObjdatLen", objData.size() * sizeof(int));
-	WriteSymbol(mName + "Objdat", DatType<uint32_t>(), objData.size());
+	WriteArraySymbol<uint32_t>("Objdat", objData.size(), packed);
+}
+
+void HeaderWriter::WriteObjectArrays(const convert::ObjectArrays& arrays)
+{
+	stream << std::endl;
+	WriteDefine(mName + "ObjCount", arrays.ids.size());
+	WriteSymbol(mName + "ObjIds", DatType<uint32_t>(), arrays.ids.size());
+	if (!arrays.x16.empty())
+	{
+		WriteSymbol(mName + "ObjX", DatType<int16_t>(), arrays.x16.size());
+		WriteSymbol(mName + "ObjY", DatType<int16_t>(), arrays.y16.size());
+	}
+	else
+	{
+		WriteSymbol(mName + "ObjX", DatType<uint32_t>(), arrays.x.size());
+		WriteSymbol(mName + "ObjY", DatType<uint32_t>(), arrays.y.size());
+	}
+}
+
+std::string HeaderWriter::TileLutSuffix(const std::string_view property, unsigned tileset)
+{
+	return Capitalise(property) + "Lut" + std::to_string(tileset);
+}
+
+void HeaderWriter::WriteTileLut(const std::string_view property, const convert::TileLut& lut)
+{
+	const std::string name = mName + TileLutSuffix(property, lut.tileset);
+	if (lut.tileset == 0)
+		stream << std::endl;
+	WriteDefine(name + "Len", lut.values.size());
+	WriteSymbol(name, lut.wide ? DatType<uint16_t>() : DatType<uint8_t>(), lut.values.size());
+}
+
+void HeaderWriter::WriteFlowField(const convert::FlowField& field)
+{
+	const std::string goal = std::to_string(field.goal);
+	stream << std::endl;
+	WriteDefine(mName + "Flow" + goal + "Stride", field.stride);
+	WriteSymbol(mName + "Flow" + goal, DatType<uint8_t>(), field.directions.size());
+	if (!field.distances.empty())
+		WriteSymbol(mName + "Dist" + goal, DatType<uint16_t>(), field.distances.size());
+}
+
+void HeaderWriter::WriteRegions(const convert::RegionGraph& regions)
+{
+	const std::string_view type = regions.wide ? DatType<uint16_t>() : DatType<uint8_t>();
+	stream << std::endl;
+	WriteDefine(mName + "RegionCount", regions.count);
+	WriteDefine(mName + "RegionCellWidth", regions.cellWidth);
+	WriteDefine(mName + "RegionCellHeight", regions.cellHeight);
+	WriteDefine(mName + "RegionColumns", regions.columns);
+	WriteDefine(mName + "RegionRows", regions.rows);
+	WriteDefine(mName + "RegionNeighbourCount", regions.neighbours.size());
+	WriteSymbol(mName + "RegionMap", type, regions.map.size());
+	WriteSymbol(mName + "RegionNeighbourOffsets", DatType<uint32_t>(), regions.offsets.size());
+	WriteSymbol(mName + "RegionNeighbours", type, regions.neighbours.size());
+}
+
+void HeaderWriter::WriteTileMasks(const convert::TileMasks& masks)
+{
+	const std::string tileset = std::to_string(masks.tileset);
+	if (masks.tileset == 0)
+		stream << std::endl;
+	if (!masks.masks.empty())
+	{
+		WriteDefine(mName + "TileMasks" + tileset + "Len", masks.masks.size());
+		WriteSymbol(mName + "TileMasks" + tileset, DatType<uint8_t>(), masks.masks.size());
+	}
+	if (!masks.heights.empty())
+	{
+		WriteDefine(mName + "TileHeights" + tileset + "Len", masks.heights.size());
+		WriteSymbol(mName + "TileHeights" + tileset, DatType<uint8_t>(), masks.heights.size());
+	}
+}
+
+void HeaderWriter::WriteAnimations(const convert::Animations& anims)
+{
+	stream << std::endl;
+	WriteDefine(mName + "AnimCount", anims.tiles.size());
+	if (anims.tiles.empty())
+		return;
+	WriteDefine(mName + "AnimFrameCount", anims.frames.size());
+	WriteDefine(mName + "AnimPositionCount", anims.positions.size());
+	WriteSymbol(mName + "AnimTiles", DatType<uint16_t>(), anims.tiles.size());
+	WriteSymbol(mName + "AnimTilesets", DatType<uint8_t>(), anims.tilesets.size());
+	WriteSymbol(mName + "AnimFrameOffsets", DatType<uint16_t>(), anims.frameOffsets.size());
+	WriteSymbol(mName + "AnimFrames", DatType<uint16_t>(), anims.frames.size());
+	WriteSymbol(mName + "AnimDurations", DatType<uint16_t>(), anims.durations.size());
+	WriteSymbol(mName + "AnimPositionOffsets", DatType<uint32_t>(), anims.positionOffsets.size());
+	WriteSymbol(mName + "AnimPositions", DatType<uint32_t>(), anims.positions.size());
+}
+
+void HeaderWriter::WriteObjectProperties(const convert::PropertySchema& schema, const convert::ObjectRecords& records)
+{
+	WriteDefine(mName + "ObjPropsSize", records.size);
+	for (const auto& field : schema.fields)
+	{
+		WriteDefine(mName + "ObjProp" + Capitalise(field.name) + "Offset", field.offset);
+	}
+	WriteSymbol(mName + "ObjProps", DatType<uint8_t>(), records.data.size());
+}
+
+void HeaderWriter::WriteObjectGroups(const std::span<const convert::ObjectGroup> groups)
+{
+	WriteDefine(mName + "ObjTypeCount", groups.size());
+	for (const auto& group : groups)
+	{
+		const std::string name = mName + "ObjType" + std::to_string(group.id);
+		WriteDefine(name + "First", group.first);
+		WriteDefine(name + "Count", group.count);
+	}
+}
+
+void HeaderWriter::WriteObjectGrid(const convert::ObjectGrid& grid)
+{
+	WriteDefine(mName + "ObjCellWidth", grid.cellWidth);
+	WriteDefine(mName + "ObjCellHeight", grid.cellHeight);
+	WriteDefine(mName + "ObjCellsX", grid.columns);
+	WriteDefine(mName + "ObjCellsY", grid.rows);
+	WriteSymbol(mName + "ObjCells", DatType<uint32_t>(), grid.offsets.size());
+}
+
+void HeaderWriter::WriteObjectColumns(const convert::ObjectColumns& columns)
+{
+	WriteDefine(mName + "ObjColumnWidth", columns.width);
+	WriteDefine(mName + "ObjColumnCount", columns.index.size() - 1);
+	WriteSymbol(mName + "ObjColumns", DatType<uint32_t>(), columns.index.size());
 }
 
 
@@ -88,5 +325,8 @@ void HeaderWriter::WriteDefine(const std::string_view name, const std::string_vi
 
 void HeaderWriter::WriteSymbol(const std::string_view name, const std::string_view type, std::size_t count)
 {
+	// Empty arrays aren't written to the assembly & C has no zero length arrays
+	if (count == 0)
+		return;
 	stream << "extern const " << type << " " << name << "[" << count << "];" << std::endl;
 }
@@ -3,6 +3,8 @@
 #ifndef HEADERWRITER_HPP
 #define HEADERWRITER_HPP
 
+#include "compress.hpp"
+#include "convert.hpp"
 #include <cstddef>
 #include <cstdint>
 #include <string>
@@ -22,12 +24,17 @@ class HeaderWriter
 
 	void WriteGuardStart();
 	void WriteGuardEnd();
+	template <typename T>
+	void WriteArraySymbol(const std::string_view suffix, std::size_t count, const compress::Packed* packed);
 
 public:
 	~HeaderWriter();
 
 	[[nodiscard]] bool Open(const std::filesystem::path& path, const std::string_view name);
 
+	// Symbol suffix of a tile property lookup table, shared with the assembly output
+	[[nodiscard]] static std::string TileLutSuffix(const std::string_view property, unsigned tileset);
+
 	void WriteDefine(const std::string_view name, const std::string_view value);
 	void WriteSymbol(const std::string_view name, const std::string_view type, std::size_t count);
 
@@ -38,9 +45,29 @@ public:
 	}
 
 	void WriteSize(unsigned width, unsigned height);
-	void WriteCharacterMap(const std::span<uint16_t> charData);
-	void WriteCollision(const std::span<uint8_t> collisionData);
-	void WriteObjects(const std::span<uint32_t> objData);
+	void WriteScreenblocks(unsigned columns, unsigned rows);
+	void WriteColumns(unsigned height);
+	void WriteStrips(unsigned count, unsigned width, unsigned height);
+	// Arrays written compressed declare the packed bytes instead of the original elements
+	void WriteCharacterMap(const std::span<uint16_t> charData, const compress::Packed* packed = nullptr);
+	void WriteCharacterMap(const std::span<uint16_t> charData, const compress::Regions& regions);
+	void WriteMetatiles(const convert::Metatiles& metatiles,
+		const compress::Packed* dictPacked = nullptr, const compress::Packed* mapPacked = nullptr);
+	void WriteAffineMap(const std::span<uint8_t> affineData, unsigned size, const compress::Packed* packed = nullptr);
+	void WriteCollision(const std::span<uint8_t> collisionData, const compress::Packed* packed = nullptr);
+	void WriteCollisionBits(const convert::CollisionBits& info);
+	void WriteCollisionRuns(const std::string_view lines, const convert::CollisionRuns& runs);
+	void WriteObjects(const std::span<uint32_t> objData, const compress::Packed* packed = nullptr);
+	void WriteObjectArrays(const convert::ObjectArrays& arrays);
+	void WriteTileLut(const std::string_view property, const convert::TileLut& lut);
+	void WriteFlowField(const convert::FlowField& field);
+	void WriteRegions(const convert::RegionGraph& regions);
+	void WriteTileMasks(const convert::TileMasks& masks);
+	void WriteAnimations(const convert::Animations& anims);
+	void WriteObjectProperties(const convert::PropertySchema& schema, const convert::ObjectRecords& records);
+	void WriteObjectGroups(const std::span<const convert::ObjectGroup> groups);
+	void WriteObjectGrid(const convert::ObjectGrid& grid);
+	void WriteObjectColumns(const convert::ObjectColumns& columns);
 };
 
 #endif//HEADERWRITER_HPP
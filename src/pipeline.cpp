@@ -0,0 +1,46 @@
+/* pipeline.cpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#include "pipeline.hpp"
+#include <iomanip>
+
+
+void pipeline::PrintStats(std::ostream& out, std::span<const StageStats> stats)
+{
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+
+	out << std::left << std::setw(10) << "stage"
+		<< std::right
+		<< std::setw(8)  << "threads"
+		<< std::setw(8)  << "items"
+		<< std::setw(8)  << "failed"
+		<< std::setw(10) << "busy s"
+		<< std::setw(10) << "starved s"
+		<< std::setw(10) << "blocked s"
+		<< std::setw(7)  << "util"
+		<< "  queue max/mean/cap" << std::endl;
+
+	out << std::fixed;
+	for (const auto& s : stats)
+	{
+		out << std::left << std::setw(10) << s.name
+			<< std::right
+			<< std::setw(8) << s.threads
+			<< std::setw(8) << s.items
+			<< std::setw(8) << s.failures
+			<< std::setprecision(3)
+			<< std::setw(10) << s.busy
+			<< std::setw(10) << s.starved
+			<< std::setw(10) << s.blocked
+			<< std::setprecision(0)
+			<< std::setw(6) << s.Utilisation() * 100.0 << "%";
+		if (s.queueCapacity)
+			out << "  " << s.queueMaxDepth << "/" << std::setprecision(1) << s.queueMeanDepth << "/" << s.queueCapacity;
+		else
+			out << "  -";
+		out << std::endl;
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
@@ -0,0 +1,265 @@
+/* pipeline.hpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "profile.hpp"
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace pipeline
+{
+	using Clock = std::chrono::steady_clock;
+
+	inline double Seconds(Clock::duration d)
+	{
+		return std::chrono::duration<double>(d).count();
+	}
+
+	// Fixed capacity FIFO shared between two stages, producers block while it is full
+	//  and consumers block while it is empty until the queue has been closed
+	template <typename T>
+	class BoundedQueue
+	{
+		std::mutex mutex;
+		std::condition_variable notFull, notEmpty;
+		std::deque<T> items;
+		const std::size_t capacity;
+		bool closed = false;
+
+		std::size_t maxDepth = 0, depthSum = 0, pushes = 0;
+
+	public:
+		explicit BoundedQueue(std::size_t capacity) : capacity(std::max<std::size_t>(capacity, 1)) {}
+
+		// Returns time spent blocked on a full queue
+		Clock::duration Push(T&& item)
+		{
+			std::unique_lock lock(mutex);
+			const auto start = Clock::now();
+			notFull.wait(lock, [this] { return items.size() < capacity; });
+			const auto blocked = Clock::now() - start;
+
+			items.emplace_back(std::move(item));
+			maxDepth = std::max(maxDepth, items.size());
+			depthSum += items.size();
+			++pushes;
+
+			lock.unlock();
+			notEmpty.notify_one();
+			return blocked;
+		}
+
+		// Returns std::nullopt once the queue is closed and drained
+		std::optional<T> Pop(Clock::duration& starved)
+		{
+			std::unique_lock lock(mutex);
+			const auto start = Clock::now();
+			notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+			starved += Clock::now() - start;
+			if (items.empty())
+				return std::nullopt;
+
+			T item = std::move(items.front());
+			items.pop_front();
+
+			lock.unlock();
+			notFull.notify_one();
+			return item;
+		}
+
+		void Close()
+		{
+			{
+				std::lock_guard lock(mutex);
+				closed = true;
+			}
+			notEmpty.notify_all();
+		}
+
+		[[nodiscard]] constexpr std::size_t Capacity() const noexcept { return capacity; }
+		[[nodiscard]] constexpr std::size_t MaxDepth() const noexcept { return maxDepth; }
+		[[nodiscard]] constexpr double MeanDepth() const noexcept
+		{
+			return pushes ? static_cast<double>(depthSum) / static_cast<double>(pushes) : 0.0;
+		}
+	};
+
+	struct StageStats
+	{
+		std::string_view name;
+		unsigned threads = 0;
+		std::size_t items = 0, failures = 0;
+		double busy = 0.0, starved = 0.0, blocked = 0.0;  // Summed over all threads, in seconds
+		double wall = 0.0;
+
+		// Input queue, absent for the first stage
+		std::size_t queueCapacity = 0, queueMaxDepth = 0;
+		double queueMeanDepth = 0.0;
+
+		[[nodiscard]] double Utilisation() const
+		{
+			return (wall > 0.0 && threads) ? busy / (wall * threads) : 0.0;
+		}
+	};
+
+	struct Config
+	{
+		unsigned readers = 1, converters = 1, writers = 1;
+		std::size_t queueDepth = 0;  // 0 = twice the consuming stage's thread count
+	};
+
+	using Stats = std::array<StageStats, 3>;
+
+	namespace detail
+	{
+		struct StageTimer
+		{
+			Clock::duration busy {}, starved {}, blocked {};
+			std::size_t items = 0, failures = 0;
+
+			void Merge(StageStats& s, std::mutex& m) const
+			{
+				std::lock_guard lock(m);
+				s.busy    += Seconds(busy);
+				s.starved += Seconds(starved);
+				s.blocked += Seconds(blocked);
+				s.items    += items;
+				s.failures += failures;
+			}
+		};
+
+		template <typename F>
+		void Spawn(std::vector<std::jthread>& pool, const std::string_view name, unsigned count, F&& fn)
+		{
+			for (unsigned i = 0; i < count; ++i)
+			{
+				pool.emplace_back([=, name = std::string(name)]
+				{
+					profile::NameThread(name + " " + std::to_string(i));
+					fn();
+				});
+			}
+		}
+	}
+
+	// Runs every job through read -> convert -> write, each stage on its own pool of threads
+	//  with bounded queues in-between so I/O and conversion overlap without unbounded buffering.
+	// A stage signals failure for an item by returning std::nullopt (or false for the writer),
+	//  failed items are dropped and counted; returns true if every job made it through.
+	template <typename Job, typename Loaded, typename Converted>
+	[[nodiscard]] bool Run(std::span<const Job> jobs, const Config& cfg,
+		std::function<std::optional<Loaded>(const Job&)> read,
+		std::function<std::optional<Converted>(Loaded&&)> convert,
+		std::function<bool(Converted&&)> write,
+		Stats& stats)
+	{
+		auto clampThreads = [&](unsigned n) { return std::clamp<unsigned>(n, 1,
+			static_cast<unsigned>(std::max<std::size_t>(jobs.size(), 1))); };
+
+		stats[0] = { .name = "read",    .threads = clampThreads(cfg.readers) };
+		stats[1] = { .name = "convert", .threads = clampThreads(cfg.converters) };
+		stats[2] = { .name = "write",   .threads = clampThreads(cfg.writers) };
+
+		auto depth = [&](unsigned consumers) { return cfg.queueDepth ? cfg.queueDepth : consumers * 2; };
+		BoundedQueue<Loaded> loadedQueue(depth(stats[1].threads));
+		BoundedQueue<Converted> convertedQueue(depth(stats[2].threads));
+
+		std::mutex statsMutex;
+		std::atomic<std::size_t> nextJob = 0;
+		std::atomic<unsigned> liveReaders = stats[0].threads, liveConverters = stats[1].threads;
+		std::array<Clock::time_point, 3> stageEnd;
+
+		const auto start = Clock::now();
+		{
+			std::vector<std::jthread> pool;
+			detail::Spawn(pool, stats[0].name, stats[0].threads, [&]
+			{
+				detail::StageTimer t;
+				for (std::size_t i; (i = nextJob.fetch_add(1)) < jobs.size();)
+				{
+					const auto begin = Clock::now();
+					auto loaded = read(jobs[i]);
+					t.busy += Clock::now() - begin;
+					++t.items;
+					if (loaded.has_value())
+						t.blocked += loadedQueue.Push(std::move(loaded.value()));
+					else
+						++t.failures;
+				}
+				t.Merge(stats[0], statsMutex);
+				if (--liveReaders == 0)
+				{
+					stageEnd[0] = Clock::now();
+					loadedQueue.Close();
+				}
+			});
+			detail::Spawn(pool, stats[1].name, stats[1].threads, [&]
+			{
+				detail::StageTimer t;
+				while (auto loaded = loadedQueue.Pop(t.starved))
+				{
+					const auto begin = Clock::now();
+					auto converted = convert(std::move(loaded.value()));
+					t.busy += Clock::now() - begin;
+					++t.items;
+					if (converted.has_value())
+						t.blocked += convertedQueue.Push(std::move(converted.value()));
+					else
+						++t.failures;
+				}
+				t.Merge(stats[1], statsMutex);
+				if (--liveConverters == 0)
+				{
+					stageEnd[1] = Clock::now();
+					convertedQueue.Close();
+				}
+			});
+			detail::Spawn(pool, stats[2].name, stats[2].threads, [&]
+			{
+				detail::StageTimer t;
+				while (auto converted = convertedQueue.Pop(t.starved))
+				{
+					const auto begin = Clock::now();
+					const bool ok = write(std::move(converted.value()));
+					t.busy += Clock::now() - begin;
+					++t.items;
+					if (!ok)
+						++t.failures;
+				}
+				t.Merge(stats[2], statsMutex);
+			});
+		}
+		stageEnd[2] = Clock::now();
+
+		for (std::size_t i = 0; i < stats.size(); ++i)
+			stats[i].wall = Seconds(stageEnd[i] - start);
+		stats[1].queueCapacity  = loadedQueue.Capacity();
+		stats[1].queueMaxDepth  = loadedQueue.MaxDepth();
+		stats[1].queueMeanDepth = loadedQueue.MeanDepth();
+		stats[2].queueCapacity  = convertedQueue.Capacity();
+		stats[2].queueMaxDepth  = convertedQueue.MaxDepth();
+		stats[2].queueMeanDepth = convertedQueue.MeanDepth();
+
+		return std::all_of(stats.begin(), stats.end(), [](const auto& s) { return s.failures == 0; })
+			&& stats[2].items == jobs.size();
+	}
+
+	void PrintStats(std::ostream& out, std::span<const StageStats> stats);
+}
+
+#endif//PIPELINE_HPP
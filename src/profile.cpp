@@ -0,0 +1,423 @@
+/* profile.cpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#include "profile.hpp"
+#include "alloc.hpp"
+#include "tmxlite/Profile.hpp"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <iomanip>
+
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr std::size_t NO_MAP = std::numeric_limits<std::size_t>::max();
+
+	struct Totals
+	{
+		std::size_t calls = 0, bytes = 0;
+		Clock::duration time {};
+		Clock::time_point first = Clock::time_point::max();
+		uint64_t allocs = 0, allocBytes = 0;
+		int64_t peak = 0;
+
+		void Merge(const Totals& rhs)
+		{
+			calls += rhs.calls;
+			bytes += rhs.bytes;
+			time  += rhs.time;
+			first = std::min(first, rhs.first);
+			allocs     += rhs.allocs;
+			allocBytes += rhs.allocBytes;
+			peak = std::max(peak, rhs.peak);
+		}
+	};
+
+	// Phases are told apart by the chain of phases they ran inside of, ending with their own
+	using Path = std::vector<const char*>;
+	using Key = std::pair<std::size_t, Path>;
+
+	struct Frame
+	{
+		const char* phase;
+		std::string detail;
+		Clock::time_point start;
+		alloc::Counters heap;
+	};
+
+	struct Event
+	{
+		const char* phase;
+		std::string detail;
+		std::size_t map, bytes;
+		Clock::time_point start, end;
+		uint64_t allocs, allocBytes;
+	};
+
+	struct ThreadLog
+	{
+		std::map<Key, Totals> totals;
+		std::vector<Frame> stack;
+		std::vector<Event> events;
+		std::size_t map = NO_MAP;
+		std::size_t tid;
+		std::string name;
+	};
+
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<ThreadLog>> registry;
+	Clock::time_point epoch = Clock::now();
+
+	// Each thread records into its own log so timing never contends on a lock,
+	//  logs are owned by the registry so they outlive the threads that wrote them
+	ThreadLog& Log()
+	{
+		thread_local ThreadLog* log = []
+		{
+			std::lock_guard lock(registryMutex);
+			auto& log = registry.emplace_back(std::make_unique<ThreadLog>());
+			log->tid = registry.size();
+			return log.get();
+		}();
+		return *log;
+	}
+
+	const tmx::ProfileHooks tmxHooks =
+	{
+		.begin = profile::detail::Begin,
+		.end   = profile::detail::End
+	};
+}
+
+
+void profile::detail::Begin(const char* phase, const char* detail)
+{
+	[[maybe_unused]] alloc::Suspend suspend;
+	auto& log = Log();
+	if (tracing.load(std::memory_order_relaxed))
+		log.stack.emplace_back(Frame { phase, detail, Clock::now(), {} });
+	else
+		log.stack.emplace_back(Frame { phase, {}, Clock::now(), {} });
+
+	// Snapshot heap counters last & restart peak tracking so the phase peak is relative to its start
+	if constexpr (alloc::ENABLED)
+	{
+		auto& heap = alloc::ThreadCounters();
+		log.stack.back().heap = heap;
+		heap.peak = heap.live;
+	}
+}
+
+void profile::detail::End(std::size_t bytes)
+{
+	const auto now = Clock::now();
+	const alloc::Counters heap = alloc::ThreadCounters();
+	[[maybe_unused]] alloc::Suspend suspend;
+	auto& log = Log();
+	Frame frame = std::move(log.stack.back());
+	log.stack.pop_back();
+
+	const uint64_t allocs = heap.allocs - frame.heap.allocs;
+	const uint64_t allocBytes = heap.bytes - frame.heap.bytes;
+	if constexpr (alloc::ENABLED)
+		alloc::ThreadCounters().peak = std::max(frame.heap.peak, heap.peak);
+
+	if (tracing.load(std::memory_order_relaxed))
+		log.events.emplace_back(Event { frame.phase, std::move(frame.detail), log.map, bytes, frame.start, now,
+			allocs, allocBytes });
+
+	Path path;
+	path.reserve(log.stack.size() + 1);
+	for (const auto& parent : log.stack)
+		path.emplace_back(parent.phase);
+	path.emplace_back(frame.phase);
+
+	Totals& t = log.totals[{ log.map, std::move(path) }];
+	if (t.calls++ == 0)
+		t.first = frame.start;
+	t.bytes += bytes;
+	t.time  += now - frame.start;
+	t.allocs     += allocs;
+	t.allocBytes += allocBytes;
+	t.peak = std::max(t.peak, heap.peak - frame.heap.live);
+}
+
+
+void profile::Enable()
+{
+	detail::enabled.store(true);
+	tmx::setProfileHooks(&tmxHooks);
+}
+
+void profile::EnableTracing()
+{
+	detail::tracing.store(true);
+	Enable();
+}
+
+void profile::NameThread(std::string name)
+{
+	Log().name = std::move(name);
+}
+
+
+profile::MapScope::MapScope(std::size_t map) : previous(Log().map)
+{
+	Log().map = map;
+}
+
+profile::MapScope::~MapScope()
+{
+	Log().map = previous;
+}
+
+
+namespace
+{
+	using NamePath = std::vector<std::string_view>;
+	using Phase = std::pair<NamePath, Totals>;
+
+	// Orders phases as a tree, each phase followed by those that ran inside of it, siblings in the
+	//  order they first started. Phases whose parent was recorded under another map start a new root
+	std::vector<Phase> SortPhases(const std::map<NamePath, Totals>& phases)
+	{
+		std::map<NamePath, std::vector<const Phase*>> children;
+		std::vector<Phase> all(phases.begin(), phases.end());
+		for (const auto& phase : all)
+		{
+			NamePath parent(phase.first.begin(), phase.first.end() - 1);
+			if (!phases.contains(parent))
+				parent.clear();
+			children[parent].emplace_back(&phase);
+		}
+
+		std::vector<Phase> sorted;
+		sorted.reserve(all.size());
+		auto visit = [&](auto&& self, const NamePath& parent) -> void
+		{
+			auto found = children.find(parent);
+			if (found == children.end())
+				return;
+			auto& siblings = found->second;
+			std::stable_sort(siblings.begin(), siblings.end(), [](const Phase* a, const Phase* b)
+				{ return a->second.first < b->second.first; });
+			for (const Phase* phase : siblings)
+			{
+				sorted.emplace_back(*phase);
+				self(self, phase->first);
+			}
+		};
+		visit(visit, {});
+		return sorted;
+	}
+
+	double Seconds(const Totals& t) { return std::chrono::duration<double>(t.time).count(); }
+	double MegabytesPerSec(const Totals& t)
+	{
+		const double secs = Seconds(t);
+		return (t.bytes && secs > 0.0) ? static_cast<double>(t.bytes) / secs / 1e6 : 0.0;
+	}
+
+	void JsonString(std::ostream& out, const std::string_view str)
+	{
+		out << '"';
+		for (const char c : str)
+		{
+			switch (c)
+			{
+			case '"':  out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			case '\n': out << "\\n"; break;
+			case '\t': out << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+					out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+						<< std::dec << std::setfill(' ');
+				else
+					out << c;
+			}
+		}
+		out << '"';
+	}
+
+	void HumanTable(std::ostream& out, const std::string_view title, const std::vector<Phase>& phases)
+	{
+		out << title << std::endl;
+		out << "  " << std::left << std::setw(36) << "phase" << std::right
+			<< std::setw(8) << "calls"
+			<< std::setw(12) << "time ms"
+			<< std::setw(14) << "bytes"
+			<< std::setw(10) << "MB/s";
+		if constexpr (alloc::ENABLED)
+			out << std::setw(10) << "allocs" << std::setw(12) << "alloc KiB" << std::setw(12) << "peak KiB";
+		out << std::endl;
+		for (const auto& [path, t] : phases)
+		{
+			const std::string indented = std::string((path.size() - 1) * 2, ' ') + std::string(path.back());
+			out << "  " << std::left << std::setw(36) << indented << std::right
+				<< std::setw(8) << t.calls
+				<< std::setw(12) << std::setprecision(3) << Seconds(t) * 1e3
+				<< std::setw(14) << t.bytes
+				<< std::setw(10) << std::setprecision(1) << MegabytesPerSec(t);
+			if constexpr (alloc::ENABLED)
+			{
+				out << std::setw(10) << t.allocs
+					<< std::setw(12) << static_cast<double>(t.allocBytes) / 1024.0
+					<< std::setw(12) << static_cast<double>(t.peak) / 1024.0;
+			}
+			out << std::endl;
+		}
+	}
+
+	void JsonPhases(std::ostream& out, const std::vector<Phase>& phases)
+	{
+		out << "[";
+		for (std::size_t i = 0; i < phases.size(); ++i)
+		{
+			const auto& [path, t] = phases[i];
+			out << (i ? "," : "") << "\n\t\t\t{\"phase\": ";
+			JsonString(out, path.back());
+			out << ", \"parents\": [";
+			for (std::size_t j = 0; j + 1 < path.size(); ++j)
+			{
+				out << (j ? ", " : "");
+				JsonString(out, path[j]);
+			}
+			out << "], \"depth\": " << path.size() - 1
+				<< ", \"calls\": " << t.calls
+				<< ", \"seconds\": " << std::setprecision(9) << Seconds(t)
+				<< ", \"bytes\": " << t.bytes
+				<< ", \"mbps\": " << std::setprecision(3) << MegabytesPerSec(t);
+			if constexpr (alloc::ENABLED)
+			{
+				out << ", \"allocs\": " << t.allocs
+					<< ", \"alloc_bytes\": " << t.allocBytes
+					<< ", \"peak_bytes\": " << t.peak;
+			}
+			out << "}";
+		}
+		out << "\n\t\t]";
+	}
+}
+
+void profile::Report(std::ostream& out, Format format, std::span<const std::string> mapNames)
+{
+	// Merge thread logs per map and across all maps
+	std::map<std::size_t, std::map<NamePath, Totals>> perMap;
+	std::map<NamePath, Totals> total;
+	{
+		std::lock_guard lock(registryMutex);
+		for (const auto& log : registry)
+		{
+			for (const auto& [key, t] : log->totals)
+			{
+				// The same phase name may be a different literal in another translation unit
+				const NamePath path(key.second.begin(), key.second.end());
+				perMap[key.first][path].Merge(t);
+				total[path].Merge(t);
+			}
+		}
+	}
+
+	auto mapName = [&](std::size_t idx) -> std::string_view
+	{
+		return idx < mapNames.size() ? std::string_view(mapNames[idx]) : std::string_view("(none)");
+	};
+
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+	out << std::fixed;
+
+	if (format == Format::HUMAN)
+	{
+		for (const auto& [idx, phases] : perMap)
+		{
+			if (idx != NO_MAP)
+				HumanTable(out, "map " + std::string(mapName(idx)), SortPhases(phases));
+		}
+		if (mapNames.size() > 1 || perMap.contains(NO_MAP))
+			HumanTable(out, "total (" + std::to_string(mapNames.size()) + " maps)", SortPhases(total));
+	}
+	else
+	{
+		out << "{\n\t\"maps\": [";
+		bool first = true;
+		for (const auto& [idx, phases] : perMap)
+		{
+			if (idx == NO_MAP)
+				continue;
+			out << (first ? "" : ",") << "\n\t\t{\"map\": ";
+			JsonString(out, mapName(idx));
+			out << ", \"phases\": ";
+			JsonPhases(out, SortPhases(phases));
+			out << "}";
+			first = false;
+		}
+		out << "\n\t],\n\t\"total\": {\"maps\": " << mapNames.size() << ", \"phases\": ";
+		JsonPhases(out, SortPhases(total));
+		out << "}\n}" << std::endl;
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+void profile::WriteTrace(std::ostream& out, std::span<const std::string> mapNames)
+{
+	auto micros = [](Clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); };
+
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+	out << std::fixed << std::setprecision(3);
+
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	bool first = true;
+	auto separator = [&] { out << (first ? "\n" : ",\n"); first = false; };
+
+	std::lock_guard lock(registryMutex);
+	for (const auto& log : registry)
+	{
+		separator();
+		out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << log->tid
+			<< ", \"args\": {\"name\": ";
+		JsonString(out, log->name.empty() ? "thread " + std::to_string(log->tid) : log->name);
+		out << "}}";
+
+		for (const auto& e : log->events)
+		{
+			separator();
+			out << "{\"name\": ";
+			JsonString(out, e.phase);
+			out << ", \"cat\": \"tmx2gba\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << log->tid
+				<< ", \"ts\": " << micros(e.start - epoch)
+				<< ", \"dur\": " << micros(e.end - e.start)
+				<< ", \"args\": {";
+			out << "\"bytes\": " << e.bytes;
+			if constexpr (alloc::ENABLED)
+				out << ", \"allocs\": " << e.allocs << ", \"alloc_bytes\": " << e.allocBytes;
+			if (e.map < mapNames.size())
+			{
+				out << ", \"map\": ";
+				JsonString(out, mapNames[e.map]);
+			}
+			if (!e.detail.empty())
+			{
+				out << ", \"detail\": ";
+				JsonString(out, e.detail);
+			}
+			out << "}}";
+		}
+	}
+	out << "\n]}" << std::endl;
+
+	out.flags(flags);
+	out.precision(precision);
+}
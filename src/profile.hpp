@@ -0,0 +1,86 @@
+/* profile.hpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
+
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <cstddef>
+#include <atomic>
+#include <ostream>
+#include <span>
+#include <string>
+
+namespace profile
+{
+	enum class Format
+	{
+		HUMAN,
+		JSON
+	};
+
+	namespace detail
+	{
+		inline std::atomic<bool> enabled = false;
+		inline std::atomic<bool> tracing = false;
+
+		void Begin(const char* phase, const char* detail);
+		void End(std::size_t bytes);
+	}
+
+	// Starts collecting timings, including phases inside tmxlite
+	void Enable();
+	[[nodiscard]] inline bool Enabled() noexcept { return detail::enabled.load(std::memory_order_relaxed); }
+
+	// Additionally records every phase as a trace event, implies Enable()
+	void EnableTracing();
+
+	// Labels the calling thread in traces
+	void NameThread(std::string name);
+
+	// Times the enclosing block as a phase, phase names must be string literals
+	class Scope
+	{
+		std::size_t bytes = 0;
+		bool active;
+
+	public:
+		explicit Scope(const char* phase, const char* detail = "") : active(Enabled())
+		{
+			if (active)
+				detail::Begin(phase, detail);
+		}
+		~Scope()
+		{
+			if (active)
+				detail::End(bytes);
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		// Bytes processed by this phase, used for throughput
+		constexpr void SetBytes(std::size_t n) noexcept { bytes = n; }
+	};
+
+	// Attributes phases on the calling thread to a map until destroyed
+	class MapScope
+	{
+		std::size_t previous;
+
+	public:
+		explicit MapScope(std::size_t map);
+		~MapScope();
+
+		MapScope(const MapScope&) = delete;
+		MapScope& operator=(const MapScope&) = delete;
+	};
+
+	// Prints every phase per map followed by totals across all maps,
+	//  must only be called once all threads doing timed work have finished
+	void Report(std::ostream& out, Format format, std::span<const std::string> mapNames);
+
+	// Writes recorded events as a Chrome trace-event JSON (chrome://tracing, Perfetto),
+	//  same threading requirements as Report
+	void WriteTrace(std::ostream& out, std::span<const std::string> mapNames);
+}
+
+#endif//PROFILE_HPP
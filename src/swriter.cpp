@@ -1,9 +1,9 @@
 /* swwriter.cpp - Copyright (C) 2024 a dinosaur (zlib, see COPYING.txt) */
 
 #include "swriter.hpp"
+#include "profile.hpp"
 #include <type_traits>
 #include <limits>
-#include <assert.h>
 
 #define GNU_STYLE  0
 #define MASM_STYLE 1
@@ -131,21 +131,36 @@ void SWriter::WriteSymbol(const std::string_view suffix)
 
 void SWriter::WriteArray(const std::string_view suffix, std::span<uint8_t> data, int numCols)
 {
-	assert(data.size());
+	profile::Scope profile("SWriter::WriteArray");
+	profile.SetBytes(data.size_bytes());
+	if (data.empty())
+		return;
 	WriteSymbol(suffix);
 	WriteArrayDetail(stream, data.begin(), data.end(), numCols);
 }
 
 void SWriter::WriteArray(const std::string_view suffix, std::span<uint16_t> data, int numCols)
 {
-	assert(data.size());
+	profile::Scope profile("SWriter::WriteArray");
+	profile.SetBytes(data.size_bytes());
+	if (data.empty())
+		return;
 	WriteSymbol(suffix);
 	WriteArrayDetail(stream, data.begin(), data.end(), numCols);
 }
 
+void SWriter::WriteArray(const std::string_view suffix, std::span<int16_t> data, int numCols)
+{
+	// Assemblers take the two's complement bit pattern the same as an unsigned halfword
+	WriteArray(suffix, std::span(reinterpret_cast<uint16_t*>(data.data()), data.size()), numCols);
+}
+
 void SWriter::WriteArray(const std::string_view suffix, std::span<uint32_t> data, int numCols)
 {
-	assert(data.size());
+	profile::Scope profile("SWriter::WriteArray");
+	profile.SetBytes(data.size_bytes());
+	if (data.empty())
+		return;
 	WriteSymbol(suffix);
 	WriteArrayDetail(stream, data.begin(), data.end(), numCols);
 }
@@ -24,6 +24,7 @@ public:
 
 	void WriteArray(const std::string_view suffix, std::span<uint8_t> data, int numCols = 16);
 	void WriteArray(const std::string_view suffix, std::span<uint16_t> data, int numCols = 16);
+	void WriteArray(const std::string_view suffix, std::span<int16_t> data, int numCols = 16);
 	void WriteArray(const std::string_view suffix, std::span<uint32_t> data, int numCols = 16);
 };
 
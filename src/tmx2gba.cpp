@@ -5,21 +5,48 @@
 #include "convert.hpp"
 #include "headerwriter.hpp"
 #include "swriter.hpp"
+#include "compress.hpp"
+#include "pipeline.hpp"
+#include "profile.hpp"
 #include "config.h"
 #include <iostream>
+#include <sstream>
 #include <map>
 #include <algorithm>
+#include <thread>
 
 
 struct Arguments
 {
-	std::string inPath, outPath;
+	std::vector<std::string> inPaths, outPaths;
 	std::string layer, collisionlay, paletteLay;
 	std::string flagFile;
 	int offset = 0;
 	int palette = 0;
 	std::vector<std::string> objMappings;
-	bool help = false, showVersion = false;
+	compress::Method compression;
+	unsigned regionWidth = 0, regionHeight = 0;
+	convert::Layout layout = convert::Layout::ROW_MAJOR;
+	bool affine = false;
+	unsigned collisionBits = 8;  // 0 for automatic
+	bool rowRuns = false, columnRuns = false;
+	unsigned cellWidth = 0, cellHeight = 0;
+	unsigned objColumnWidth = 0;
+	bool objArrays = false, objGroups = false, objPixels = false;
+	bool animations = false;
+	std::vector<std::string> tileProperties;
+	bool tileMasks = false, tileHeights = false;
+	std::vector<uint32_t> flowGoals;
+	bool flowDistances = false;
+	unsigned regionCellWidth = 0, regionCellHeight = 0;
+	convert::PropertySchema objSchema;
+	std::vector<std::string> objProperties;
+	unsigned metaWidth = 0, metaHeight = 0;
+	bool metaFlips = false;
+	pipeline::Config threads = { .converters = std::max(std::thread::hardware_concurrency(), 1u) };
+	std::optional<profile::Format> timings;
+	std::string timingsPath, tracePath;
+	bool help = false, showVersion = false, stageStats = false;
 };
 
 using ArgParse::Option;
@@ -30,16 +57,178 @@ static const ArgParse::Options options =
 	Option::Optional('v', {},        "Display version & quit"),
 	Option::Optional('l', "name",    "Name of layer to use (default first layer in TMX)"),
 	Option::Optional('y', "name",    "Layer for palette mappings"),
-	Option::Optional('c', "name",    "Output a separate 8bit collision map of the specified layer"),
+	Option::Optional('c', "name",    "Output a separate 8bit collision map of the specified layer,"
+	                                 " or from the tile property of that name if there's no such layer"),
+	Option::Optional('b', "bits",    "Pack the collision map to 1, 2 or 4 bits per tile, or \"auto\" for the smallest"),
+	Option::Optional('R', "lines",   "Output collision runs of each \"rows\", \"columns\" or \"both\" for binary searching"),
 	Option::Optional('r', "offset",  "Offset tile indices (default 0)"),
 	Option::Optional('p', "0-15",    "Select which palette to use for 4-bit tilesets"),
 	Option::Optional('m', "name;id", "Map an object name to an ID, will enable object exports"),
-	Option::Required('i', "inpath",  "Path to input TMX file"),
-	Option::Required('o', "outpath", "Path to output files"),
+	Option::Optional('g', "WxH",     "Sort objects into a grid of WxH pixel cells with a table of each cell's objects"),
+	Option::Optional('x', "pixels",  "Sort objects by x with an index of the first object in each column of this width"),
+	Option::Optional('P', "name:type", "Pack an object property into per-object records as u8, u16, s16, u32"
+	                                   " or fixed (24.8), repeat for each property"),
+	Option::Optional('O', "layout",  "Write objects as \"aos\" (default) or separate \"soa\" arrays, add \"+type\" to"
+	                                 " group objects by ID or \"+px16\" for 16-bit pixel positions with soa"),
+	Option::Optional('u', "name",    "Output a lookup table of a tile property by tile index for each tileset, repeatable"),
+	Option::Optional('d', "id",      "Output a flow field over walkable collision towards objects of a mapped ID, repeatable"),
+	Option::Optional('D', {},        "Output distance maps alongside flow fields"),
+	Option::Optional('e', "WxH",     "Output walkable regions of the collision map in cells of WxH tiles & their neighbours"),
+	Option::Optional('K', "kind",    "Output 8x8 \"masks\", column \"heights\" or \"both\" rasterised from tile collision"
+	                                 " shapes for each tileset"),
+	Option::Optional('A', {},        "Output tables of tile animations & the positions of animated tiles"),
+	Option::Optional('z', "codec[+filter]", "Compress output arrays for the GBA BIOS: none, lz77, rle, huff4, huff8"
+	                                        " or auto, optionally with a diff8 or diff16 filter"),
+	Option::Optional('a', {},        "Output an 8-bit affine background map instead of a regular one"),
+	Option::Optional('M', "WxH[+flip]", "Output a dictionary of unique WxH metatiles & a map of metatile indices,"
+	                                    " \"+flip\" also matches mirrored metatiles"),
+	Option::Optional('L', "layout",  "Arrange the charmap as \"rows\" (default), \"sbb\" for screenblocks,"
+	                                 " \"columns\" or 32 tile wide row \"strips\" for streaming"),
+	Option::Optional('k', "WxH",     "Compress the charmap as separately decompressible regions of WxH tiles"),
+	Option::Required('i', "inpath",  "Path to input TMX file, repeat to convert several maps"),
+	Option::Required('o', "outpath", "Path to output files, one for each input"),
+	Option::Optional('j', "r,c,w",   "Read, convert & write stage thread counts (default 1,<cores>,1)"),
+	Option::Optional('s', {},        "Print pipeline stage statistics"),
+	Option::Optional('t', "fmt[:path]", "Report per-phase timings as \"human\" or \"json\" (default to stderr)"),
+	Option::Optional('T', "path",    "Write a Chrome trace-event JSON of the run for chrome://tracing or Perfetto"),
 	Option::Optional('f', "file",    "Specify a file to use for flags, will override any options"
 	                                 " specified on the command line")
 };
 
+static bool ParseThreadCounts(const std::string_view arg, pipeline::Config& threads)
+{
+	std::array<unsigned*, 3> counts = { &threads.readers, &threads.converters, &threads.writers };
+	std::size_t beg = 0;
+	for (auto count : counts)
+	{
+		auto end = arg.find(',', beg);
+		auto token = std::string(arg.substr(beg, end == std::string_view::npos ? end : end - beg));
+		if (!token.empty())
+		{
+			int value = std::stoi(token);
+			if (value < 1)
+				return false;
+			*count = static_cast<unsigned>(value);
+		}
+		if (end == std::string_view::npos)
+			return true;
+		beg = end + 1;
+	}
+	return false;
+}
+
+static bool ParseTimings(const std::string_view arg, Arguments& params)
+{
+	const auto splitter = arg.find(':');
+	const auto format = arg.substr(0, splitter);
+	if (format == "human")
+		params.timings = profile::Format::HUMAN;
+	else if (format == "json")
+		params.timings = profile::Format::JSON;
+	else
+		return false;
+	params.timingsPath = splitter != std::string_view::npos ? arg.substr(splitter + 1) : "";
+	return true;
+}
+
+static bool ParseCompression(const std::string_view arg, compress::Method& method)
+{
+	const auto parsed = compress::ParseMethod(arg);
+	if (!parsed.has_value())
+		return false;
+	method = parsed.value();
+	return true;
+}
+
+static bool ParseSize(const std::string_view arg, unsigned& width, unsigned& height)
+{
+	const auto splitter = arg.find('x');
+	if (splitter == std::string_view::npos)
+		return false;
+	const int w = std::stoi(std::string(arg.substr(0, splitter)));
+	const int h = std::stoi(std::string(arg.substr(splitter + 1)));
+	if (w < 1 || h < 1)
+		throw std::out_of_range("size");
+	width = static_cast<unsigned>(w);
+	height = static_cast<unsigned>(h);
+	return true;
+}
+
+static bool ParseCollisionBits(const std::string_view arg, unsigned& bits)
+{
+	if (arg == "auto")
+		bits = 0;
+	else if (arg == "1" || arg == "2" || arg == "4")
+		bits = static_cast<unsigned>(arg[0] - '0');
+	else
+		return false;
+	return true;
+}
+
+static bool ParseRuns(const std::string_view arg, Arguments& params)
+{
+	if (arg != "rows" && arg != "columns" && arg != "both")
+		return false;
+	params.rowRuns = arg != "columns";
+	params.columnRuns = arg != "rows";
+	return true;
+}
+
+static bool ParseTileMasks(const std::string_view arg, Arguments& params)
+{
+	if (arg != "masks" && arg != "heights" && arg != "both")
+		return false;
+	params.tileMasks = arg != "heights";
+	params.tileHeights = arg != "masks";
+	return true;
+}
+
+static bool ParseMetatiles(const std::string_view arg, Arguments& params)
+{
+	const auto splitter = arg.find('+');
+	if (splitter != std::string_view::npos && arg.substr(splitter + 1) != "flip")
+		return false;
+	params.metaFlips = splitter != std::string_view::npos;
+	return ParseSize(arg.substr(0, splitter), params.metaWidth, params.metaHeight);
+}
+
+static bool ParseObjectLayout(const std::string_view arg, Arguments& params)
+{
+	params.objGroups = params.objPixels = false;
+	std::size_t beg = 0;
+	for (bool first = true;; first = false)
+	{
+		const auto end = arg.find('+', beg);
+		const auto token = arg.substr(beg, end == std::string_view::npos ? end : end - beg);
+		if (first && (token == "aos" || token == "soa"))
+			params.objArrays = token == "soa";
+		else if (!first && token == "type")
+			params.objGroups = true;
+		else if (!first && token == "px16")
+			params.objPixels = true;
+		else
+			return false;
+		if (end == std::string_view::npos)
+			return true;
+		beg = end + 1;
+	}
+}
+
+static bool ParseLayout(const std::string_view arg, convert::Layout& layout)
+{
+	if (arg == "rows")
+		layout = convert::Layout::ROW_MAJOR;
+	else if (arg == "sbb")
+		layout = convert::Layout::SCREENBLOCKS;
+	else if (arg == "columns")
+		layout = convert::Layout::COLUMN_MAJOR;
+	else if (arg == "strips")
+		layout = convert::Layout::STRIPS;
+	else
+		return false;
+	return true;
+}
+
 static bool ParseArgs(int argc, char** argv, Arguments& params)
 {
 	auto parser = ArgParse::ArgParser(argv[0], options, [&](int opt, const std::string_view arg)
@@ -55,11 +244,47 @@ static bool ParseArgs(int argc, char** argv, Arguments& params)
 			case 'l': params.layer = arg;        return ParseCtrl::CONTINUE;
 			case 'c': params.collisionlay = arg; return ParseCtrl::CONTINUE;
 			case 'y': params.paletteLay = arg;   return ParseCtrl::CONTINUE;
+			case 'b': return ParseCollisionBits(arg, params.collisionBits) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
+			case 'R': return ParseRuns(arg, params) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
 			case 'r': params.offset = std::stoi(std::string(arg));  return ParseCtrl::CONTINUE;
 			case 'p': params.palette = std::stoi(std::string(arg)); return ParseCtrl::CONTINUE;
 			case 'm': params.objMappings.emplace_back(arg);         return ParseCtrl::CONTINUE;
-			case 'i': params.inPath = arg;       return ParseCtrl::CONTINUE;
-			case 'o': params.outPath = arg;      return ParseCtrl::CONTINUE;
+			case 'g': return ParseSize(arg, params.cellWidth, params.cellHeight) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
+			case 'x':
+			{
+				const int width = std::stoi(std::string(arg));
+				if (width < 1)
+					return ParseCtrl::QUIT_ERR_RANGE;
+				params.objColumnWidth = static_cast<unsigned>(width);
+				return ParseCtrl::CONTINUE;
+			}
+			case 'P':
+				if (!convert::AddPropertyField(params.objSchema, arg))
+					return ParseCtrl::QUIT_ERR_INVALID;
+				params.objProperties.emplace_back(params.objSchema.fields.back().name);
+				return ParseCtrl::CONTINUE;
+			case 'O': return ParseObjectLayout(arg, params) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
+			case 'A': params.animations = true;  return ParseCtrl::CONTINUE;
+			case 'd': params.flowGoals.emplace_back(std::stoul(std::string(arg))); return ParseCtrl::CONTINUE;
+			case 'D': params.flowDistances = true; return ParseCtrl::CONTINUE;
+			case 'e': return ParseSize(arg, params.regionCellWidth, params.regionCellHeight) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
+			case 'K': return ParseTileMasks(arg, params) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
+			case 'u':
+				if (!convert::IsIdentifier(arg))
+					return ParseCtrl::QUIT_ERR_INVALID;
+				params.tileProperties.emplace_back(arg);
+				return ParseCtrl::CONTINUE;
+			case 'z': return ParseCompression(arg, params.compression) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
+			case 'a': params.affine = true;      return ParseCtrl::CONTINUE;
+			case 'M': return ParseMetatiles(arg, params) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
+			case 'L': return ParseLayout(arg, params.layout) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
+			case 'k': return ParseSize(arg, params.regionWidth, params.regionHeight) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
+			case 'i': params.inPaths.emplace_back(arg);  return ParseCtrl::CONTINUE;
+			case 'o': params.outPaths.emplace_back(arg); return ParseCtrl::CONTINUE;
+			case 'j': return ParseThreadCounts(arg, params.threads) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_RANGE;
+			case 's': params.stageStats = true;  return ParseCtrl::CONTINUE;
+			case 't': return ParseTimings(arg, params) ? ParseCtrl::CONTINUE : ParseCtrl::QUIT_ERR_INVALID;
+			case 'T': params.tracePath = arg;    return ParseCtrl::CONTINUE;
 			case 'f': params.flagFile = arg;     return ParseCtrl::CONTINUE;
 
 			default: return ParseCtrl::QUIT_ERR_UNKNOWN;
@@ -96,21 +321,84 @@ static bool ParseArgs(int argc, char** argv, Arguments& params)
 	}
 
 	// Check my paranoia
-	if (params.inPath.empty())
+	if (params.inPaths.empty())
 	{
 		parser.DisplayError("No input file specified.");
 		return false;
 	}
-	if (params.outPath.empty())
+	if (params.outPaths.empty())
 	{
 		parser.DisplayError("No output file specified.");
 		return false;
 	}
+	if (params.inPaths.size() != params.outPaths.size())
+	{
+		parser.DisplayError("Number of input and output paths differ.");
+		return false;
+	}
 	if (params.palette < 0 || params.palette > 15)
 	{
 		parser.DisplayError("Invalid palette index.");
 		return false;
 	}
+	if (params.affine && params.layout != convert::Layout::ROW_MAJOR)
+	{
+		parser.DisplayError("Affine maps can't use another layout.");
+		return false;
+	}
+	if (params.affine && params.regionWidth)
+	{
+		parser.DisplayError("Affine maps can't be compressed in regions.");
+		return false;
+	}
+	if (params.cellWidth && params.objColumnWidth)
+	{
+		parser.DisplayError("Objects can't be both sorted into a grid and by x.");
+		return false;
+	}
+	if (params.objGroups && (params.cellWidth || params.objColumnWidth))
+	{
+		parser.DisplayError("Objects can't be grouped by type when sorted spatially.");
+		return false;
+	}
+	if (params.objPixels && !params.objArrays)
+	{
+		parser.DisplayError("16-bit object positions need the soa layout.");
+		return false;
+	}
+	if (params.metaWidth && (params.affine || params.layout != convert::Layout::ROW_MAJOR || params.regionWidth))
+	{
+		parser.DisplayError("Metatiles can't be combined with affine maps, layouts or regions.");
+		return false;
+	}
+	if (!params.flowGoals.empty() && (params.collisionlay.empty() || params.objMappings.empty()))
+	{
+		parser.DisplayError("Flow fields need a collision layer & mapped goal objects.");
+		return false;
+	}
+	if (params.regionCellWidth && params.collisionlay.empty())
+	{
+		parser.DisplayError("Regions need a collision layer.");
+		return false;
+	}
+	if (params.flowDistances && params.flowGoals.empty())
+	{
+		parser.DisplayError("Distance maps need a flow field goal.");
+		return false;
+	}
+	if (params.regionWidth)
+	{
+		if (params.compression.codec == compress::Codec::AUTO)
+		{
+			parser.DisplayError("Region compression needs a fixed codec.");
+			return false;
+		}
+		if (static_cast<std::size_t>(params.regionWidth) * params.regionHeight * 2 > compress::MAX_SIZE)
+		{
+			parser.DisplayError("Region size is too large.");
+			return false;
+		}
+	}
 
 	return true;
 }
@@ -135,6 +423,541 @@ static std::string SanitiseLabel(const std::string_view ident)
 	return out;
 }
 
+struct Job
+{
+	std::size_t index;
+	std::string inPath, outPath;
+	std::string prefix;  // Prepended to error messages to tell apart maps in batch mode
+};
+
+struct LoadedMap
+{
+	const Job* job;
+	TmxReader tmx;
+};
+
+struct ConvertedMap
+{
+	const Job* job;
+	TmxReader::Size size;
+	convert::Layout layout;
+	std::vector<uint16_t> charDat {};
+	std::vector<uint8_t> affineDat {};
+	std::optional<std::vector<uint8_t>> collisionDat {};
+	std::optional<convert::CollisionBits> collisionBits {};
+	std::optional<convert::CollisionRuns> rowRuns {}, columnRuns {};
+	std::optional<std::vector<uint32_t>> objDat {};
+	std::optional<convert::ObjectGrid> objGrid {};
+	std::optional<convert::ObjectColumns> objColumns {};
+	std::optional<std::vector<convert::ObjectGroup>> objGroups {};
+	std::optional<convert::ObjectArrays> objArrays {};
+	std::optional<convert::ObjectRecords> objRecords {};
+	std::optional<convert::Animations> animations {};
+	std::vector<convert::TileLut> tileLuts {};
+	std::vector<convert::TileMasks> tileMasks {};
+	std::vector<convert::FlowField> flowFields {};
+	std::optional<convert::RegionGraph> regions {};
+	std::optional<compress::Packed> charPacked {}, collisionPacked {}, objPacked {};
+	std::optional<compress::Regions> charRegions {};
+	std::optional<convert::Metatiles> metatiles {};
+	std::optional<compress::Packed> metaPacked {}, metaMapPacked {};
+};
+
+static void ReportError(const Job& job, const std::string_view message)
+{
+	// Build the line up front so messages from concurrent stages don't interleave
+	std::ostringstream line;
+	line << job.prefix << message << std::endl;
+	std::cerr << line.str();
+}
+
+static std::optional<LoadedMap> ReadMap(const Job& job, const Arguments& p,
+	const std::map<std::string, uint32_t>& objMapping)
+{
+	LoadedMap loaded { &job, {} };
+	switch (loaded.tmx.Open(job.inPath,
+		p.layer, p.paletteLay, p.collisionlay, objMapping, p.objProperties, p.tileProperties,
+		p.tileMasks || p.tileHeights, p.animations))
+	{
+	case TmxReader::Error::LOAD_FAILED:
+		ReportError(job, "Failed to open input file.");
+		return std::nullopt;
+	case TmxReader::Error::NO_LAYERS:
+		ReportError(job, "No suitable tile layer found.");
+		return std::nullopt;
+	case TmxReader::Error::GRAPHICS_NOTFOUND:
+		ReportError(job, "No graphics layer \"" + p.layer + "\" found.");
+		return std::nullopt;
+	case TmxReader::Error::PALETTE_NOTFOUND:
+		ReportError(job, "No palette layer \"" + p.paletteLay + "\" found.");
+		return std::nullopt;
+	case TmxReader::Error::COLLISION_NOTFOUND:
+		ReportError(job, "No collision layer \"" + p.collisionlay + "\" found.");
+		return std::nullopt;
+	case TmxReader::Error::OK:
+		break;
+	}
+	return loaded;
+}
+
+template <typename T>
+static bool CompressArray(const Job& job, const std::string_view name, std::span<const T> data,
+	compress::Method method, bool vramSafe, std::optional<compress::Packed>& packed)
+{
+	if (data.size_bytes() > compress::MAX_SIZE)
+	{
+		ReportError(job, std::string(name) + " is too large to compress.");
+		return false;
+	}
+	packed = compress::Compress(method, data, vramSafe);
+	if (!packed.has_value())
+	{
+		ReportError(job, "Failed to compress " + std::string(name) + " with the requested codec.");
+		return false;
+	}
+	// Automatic selection may find nothing beats the original
+	if (packed->codec == compress::Codec::NONE)
+		packed.reset();
+	return true;
+}
+
+static bool CompressMap(ConvertedMap& map, compress::Method method, unsigned regionWidth, unsigned regionHeight)
+{
+	const Job& job = *map.job;
+	// Charmaps are decompressed straight into screenblocks so must be safe for VRAM
+	if (regionWidth)
+	{
+		// Screenblocks & strips are stacked one under the other as far as regions are concerned,
+		//  a column-major map is its transpose
+		unsigned width = map.size.width;
+		if (map.layout == convert::Layout::SCREENBLOCKS || map.layout == convert::Layout::STRIPS)
+			width = 32;
+		else if (map.layout == convert::Layout::COLUMN_MAJOR)
+			width = map.size.height;
+		const unsigned height = static_cast<unsigned>(map.charDat.size() / width);
+		// Regions default to LZ77, every region must be decodable the same way
+		compress::Method regionMethod = method;
+		if (regionMethod.codec == compress::Codec::NONE)
+			regionMethod.codec = compress::Codec::LZ77;
+		map.charRegions = compress::CompressRegions(regionMethod, map.charDat,
+			width, height, regionWidth, regionHeight, true);
+		if (!map.charRegions.has_value())
+		{
+			ReportError(job, "Failed to compress Tiles with the requested codec.");
+			return false;
+		}
+	}
+	else if (!map.affineDat.empty())
+	{
+		if (!CompressArray<uint8_t>(job, "Tiles", map.affineDat, method, true, map.charPacked))
+			return false;
+	}
+	else if (map.metatiles.has_value())
+	{
+		if (!CompressArray<uint16_t>(job, "Metatiles", map.metatiles->dictionary, method, false, map.metaPacked)
+			|| !CompressArray<uint16_t>(job, "MetatileMap", map.metatiles->map, method, false, map.metaMapPacked))
+			return false;
+	}
+	else if (!CompressArray<uint16_t>(job, "Tiles", map.charDat, method, true, map.charPacked))
+	{
+		return false;
+	}
+
+	// Regions alone leave the other arrays uncompressed
+	if (method.codec == compress::Codec::NONE)
+		return true;
+	if (map.collisionDat.has_value()
+		&& !CompressArray<uint8_t>(job, "Collision", map.collisionDat.value(), method, false, map.collisionPacked))
+		return false;
+	if (map.objDat.has_value()
+		&& !CompressArray<uint32_t>(job, "Objdat", map.objDat.value(), method, false, map.objPacked))
+		return false;
+	return true;
+}
+
+static std::optional<ConvertedMap> ConvertMap(LoadedMap&& loaded, const Arguments& p)
+{
+	const TmxReader& tmx = loaded.tmx;
+	ConvertedMap out { .job = loaded.job, .size = tmx.GetSize(), .layout = p.layout };
+
+	// Convert to GBA-friendly charmap data
+	if (p.affine)
+	{
+		switch (convert::ConvertAffine(out.affineDat, p.offset, tmx))
+		{
+		case convert::AffineError::TOO_LARGE:
+			ReportError(*loaded.job, "Map is too large for an affine background, 128x128 tiles at most.");
+			return std::nullopt;
+		case convert::AffineError::INDEX_RANGE:
+			ReportError(*loaded.job, "Tile index exceeds 255, affine maps only hold 8-bit indices.");
+			return std::nullopt;
+		case convert::AffineError::FLIPPED:
+			ReportError(*loaded.job, "Flipped tile found, affine maps can't flip tiles.");
+			return std::nullopt;
+		case convert::AffineError::OK:
+			break;
+		}
+	}
+	else if (!convert::ConvertCharmap(out.charDat, p.offset, p.palette, tmx))
+	{
+		return std::nullopt;
+	}
+
+	if (p.layout == convert::Layout::SCREENBLOCKS)
+	{
+		std::vector<uint16_t> arranged;
+		if (!convert::ArrangeScreenblocks(arranged, out.charDat, out.size.width, out.size.height))
+		{
+			ReportError(*loaded.job, "Map is too large to arrange in screenblocks, 64x64 tiles at most.");
+			return std::nullopt;
+		}
+		out.charDat = std::move(arranged);
+	}
+	else if (p.metaWidth)
+	{
+		if (!convert::ExtractMetatiles(out.metatiles.emplace(), out.charDat, out.size.width, out.size.height,
+			p.metaWidth, p.metaHeight, p.metaFlips))
+		{
+			ReportError(*loaded.job, p.metaFlips
+				? "Too many unique metatiles, at most 1024 can be indexed with flips."
+				: "Too many unique metatiles, at most 65536 can be indexed.");
+			return std::nullopt;
+		}
+		out.charDat.clear();
+	}
+
+	// Convert collision map
+	if (tmx.HasCollisionTiles())
+	{
+		if (!convert::ConvertCollision(out.collisionDat.emplace(), tmx))
+		{
+			ReportError(*loaded.job, "Collision tile property \"" + p.collisionlay
+				+ "\" must be a whole number from 0 to 255.");
+			return std::nullopt;
+		}
+		if (p.rowRuns)
+			convert::FindCollisionRuns(out.rowRuns.emplace(), out.collisionDat.value(),
+				out.size.width, out.size.height, false);
+		if (p.columnRuns)
+			convert::FindCollisionRuns(out.columnRuns.emplace(), out.collisionDat.value(),
+				out.size.width, out.size.height, true);
+
+		uint32_t goal;
+		if (!p.flowGoals.empty() && !convert::ComputeFlowFields(out.flowFields, goal, p.flowGoals, p.flowDistances,
+			out.collisionDat.value(), out.size.width, out.size.height, tmx))
+		{
+			ReportError(*loaded.job, "No object with ID " + std::to_string(goal) + " on a walkable tile.");
+			return std::nullopt;
+		}
+		if (p.regionCellWidth && !convert::FindRegions(out.regions.emplace(), out.collisionDat.value(),
+			out.size.width, out.size.height, p.regionCellWidth, p.regionCellHeight))
+		{
+			ReportError(*loaded.job, "Too many regions, at most 65535 can be numbered.");
+			return std::nullopt;
+		}
+	}
+
+	if (p.animations)
+		convert::ConvertAnimations(out.animations.emplace(), p.offset, tmx);
+	if (p.tileMasks || p.tileHeights)
+		convert::ConvertTileMasks(out.tileMasks, p.tileMasks, p.tileHeights, p.offset, tmx);
+
+	if (!p.tileProperties.empty())
+	{
+		std::string property;
+		switch (convert::ConvertTileProperties(out.tileLuts, property, p.tileProperties, p.offset, tmx))
+		{
+		case convert::PropertyError::NOT_A_NUMBER:
+			ReportError(*loaded.job, "Tile property \"" + property + "\" isn't a number.");
+			return std::nullopt;
+		case convert::PropertyError::OUT_OF_RANGE:
+			ReportError(*loaded.job, "Tile property \"" + property + "\" is out of range, 0-65535 allowed.");
+			return std::nullopt;
+		case convert::PropertyError::OK:
+			break;
+		}
+	}
+
+	// Lay out tiles & collision the same way for streaming
+	if (p.layout == convert::Layout::COLUMN_MAJOR || p.layout == convert::Layout::STRIPS)
+	{
+		auto arrange = [&]<typename T>(std::vector<T>& data)
+		{
+			std::vector<T> arranged;
+			if (p.layout == convert::Layout::COLUMN_MAJOR)
+				convert::ArrangeColumns(arranged, data, out.size.width, out.size.height);
+			else
+				convert::ArrangeStrips(arranged, data, out.size.width, out.size.height);
+			data = std::move(arranged);
+		};
+		arrange(out.charDat);
+		if (out.collisionDat.has_value())
+			arrange(out.collisionDat.value());
+	}
+
+	if (out.collisionDat.has_value() && p.collisionBits != 8)
+	{
+		// Pack each row of collision as it's laid out
+		unsigned rowLength = out.size.width;
+		if (p.layout == convert::Layout::COLUMN_MAJOR)
+			rowLength = out.size.height;
+		else if (p.layout == convert::Layout::STRIPS)
+			rowLength = convert::STRIP_WIDTH;
+		std::vector<uint8_t> packed;
+		if (!convert::PackCollision(packed, out.collisionBits.emplace(), out.collisionDat.value(),
+			rowLength, p.collisionBits))
+		{
+			ReportError(*loaded.job, "Collision uses " + std::to_string(out.collisionBits->ids.size())
+				+ " different IDs, too many to pack " + (p.collisionBits
+					? "to " + std::to_string(p.collisionBits) + " bits." : "to 4 bits or less."));
+			return std::nullopt;
+		}
+		out.collisionDat = std::move(packed);
+	}
+
+	if (tmx.HasObjects())
+	{
+		if (!convert::ConvertObjects(out.objDat.emplace(), tmx))
+			return std::nullopt;
+		if (!p.objSchema.fields.empty())
+		{
+			std::string field;
+			switch (convert::PackObjectProperties(out.objRecords.emplace(), field, p.objSchema, tmx))
+			{
+			case convert::PropertyError::NOT_A_NUMBER:
+				ReportError(*loaded.job, "Object property \"" + field + "\" isn't a number.");
+				return std::nullopt;
+			case convert::PropertyError::OUT_OF_RANGE:
+				ReportError(*loaded.job, "Object property \"" + field + "\" is out of range for its type.");
+				return std::nullopt;
+			case convert::PropertyError::OK:
+				break;
+			}
+		}
+
+		auto records = out.objRecords.has_value() ? &out.objRecords.value() : nullptr;
+		if (p.cellWidth)
+			convert::BucketObjects(out.objDat.value(), out.objGrid.emplace(), out.size.width, out.size.height,
+				p.cellWidth, p.cellHeight, records);
+		else if (p.objColumnWidth)
+			convert::SortObjectsByX(out.objDat.value(), out.objColumns.emplace(), out.size.width, p.objColumnWidth,
+				records);
+		else if (p.objGroups)
+			convert::GroupObjects(out.objDat.value(), out.objGroups.emplace(), records);
+
+		if (p.objArrays)
+		{
+			if (!convert::SplitObjects(out.objArrays.emplace(), out.objDat.value(), p.objPixels))
+			{
+				ReportError(*loaded.job, "Object position out of range for 16-bit pixels.");
+				return std::nullopt;
+			}
+			// Separate arrays replace Objdat & aren't compressed
+			out.objDat.reset();
+		}
+	}
+
+	if ((p.compression.codec != compress::Codec::NONE || p.regionWidth)
+		&& !CompressMap(out, p.compression, p.regionWidth, p.regionHeight))
+		return std::nullopt;
+
+	return out;
+}
+
+static bool WriteMap(ConvertedMap&& map, const Arguments& p)
+{
+	const Job& job = *map.job;
+
+	// Get name from file
+	std::string name = SanitiseLabel(std::filesystem::path(job.outPath).stem().string());
+
+	// Open output files
+	SWriter outS;
+	if (!outS.Open(job.outPath + ".s", name))
+	{
+		ReportError(job, "Failed to create output file \"" + job.outPath + ".s\".");
+		return false;
+	}
+	HeaderWriter outH;
+	if (!outH.Open(job.outPath + ".h", name))
+	{
+		ReportError(job, "Failed to create output file \"" + job.outPath + ".h\".");
+		return false;
+	}
+
+	// Write out header
+	{
+		profile::Scope profile("HeaderWriter");
+		outH.WriteSize(map.size.width, map.size.height);
+		if (map.layout == convert::Layout::SCREENBLOCKS)
+			outH.WriteScreenblocks(convert::ScreenblocksFor(map.size.width), convert::ScreenblocksFor(map.size.height));
+		else if (map.layout == convert::Layout::COLUMN_MAJOR)
+			outH.WriteColumns(map.size.height);
+		else if (map.layout == convert::Layout::STRIPS)
+			outH.WriteStrips(convert::StripsFor(map.size.width), convert::STRIP_WIDTH, map.size.height);
+		auto packed = [](std::optional<compress::Packed>& p) { return p.has_value() ? &p.value() : nullptr; };
+		if (!map.affineDat.empty())
+			outH.WriteAffineMap(map.affineDat, convert::AffineSizeFor(std::max(map.size.width, map.size.height)),
+				packed(map.charPacked));
+		else if (map.metatiles.has_value())
+			outH.WriteMetatiles(map.metatiles.value(), packed(map.metaPacked), packed(map.metaMapPacked));
+		else if (map.charRegions.has_value())
+			outH.WriteCharacterMap(map.charDat, map.charRegions.value());
+		else
+			outH.WriteCharacterMap(map.charDat, packed(map.charPacked));
+		if (map.collisionDat.has_value())
+			outH.WriteCollision(map.collisionDat.value(), packed(map.collisionPacked));
+		if (map.collisionBits.has_value())
+			outH.WriteCollisionBits(map.collisionBits.value());
+		if (map.rowRuns.has_value())
+			outH.WriteCollisionRuns("Row", map.rowRuns.value());
+		if (map.columnRuns.has_value())
+			outH.WriteCollisionRuns("Column", map.columnRuns.value());
+		if (map.objDat.has_value())
+			outH.WriteObjects(map.objDat.value(), packed(map.objPacked));
+		if (map.objArrays.has_value())
+			outH.WriteObjectArrays(map.objArrays.value());
+		for (const auto& lut : map.tileLuts)
+			outH.WriteTileLut(p.tileProperties[lut.property], lut);
+		for (const auto& masks : map.tileMasks)
+			outH.WriteTileMasks(masks);
+		for (const auto& field : map.flowFields)
+			outH.WriteFlowField(field);
+		if (map.regions.has_value())
+			outH.WriteRegions(map.regions.value());
+		if (map.animations.has_value())
+			outH.WriteAnimations(map.animations.value());
+		if (map.objRecords.has_value())
+			outH.WriteObjectProperties(p.objSchema, map.objRecords.value());
+		if (map.objGroups.has_value())
+			outH.WriteObjectGroups(map.objGroups.value());
+		if (map.objGrid.has_value())
+			outH.WriteObjectGrid(map.objGrid.value());
+		if (map.objColumns.has_value())
+			outH.WriteObjectColumns(map.objColumns.value());
+	}
+
+	// Write out charmap, collision map & objects
+	if (map.charRegions.has_value())
+	{
+		outS.WriteArray("Tiles", map.charRegions->data);
+		outS.WriteArray("TilesOffsets", map.charRegions->offsets);
+	}
+	else if (map.charPacked.has_value())
+		outS.WriteArray("Tiles", map.charPacked->data);
+	else if (!map.affineDat.empty())
+		outS.WriteArray("Tiles", map.affineDat);
+	else if (map.metatiles.has_value())
+	{
+		if (map.metaPacked.has_value())
+			outS.WriteArray("Metatiles", map.metaPacked->data);
+		else
+			outS.WriteArray("Metatiles", map.metatiles->dictionary);
+		if (map.metaMapPacked.has_value())
+			outS.WriteArray("MetatileMap", map.metaMapPacked->data);
+		else
+			outS.WriteArray("MetatileMap", map.metatiles->map);
+	}
+	else
+		outS.WriteArray("Tiles", map.charDat);
+	if (map.collisionPacked.has_value())
+		outS.WriteArray("Collision", map.collisionPacked->data);
+	else if (map.collisionDat.has_value())
+		outS.WriteArray("Collision", map.collisionDat.value(), 32);
+	if (map.collisionBits.has_value())
+		outS.WriteArray("CollisionIds", map.collisionBits->ids, 32);
+	if (map.rowRuns.has_value())
+	{
+		outS.WriteArray("CollisionRowRuns", map.rowRuns->runs);
+		outS.WriteArray("CollisionRowOffsets", map.rowRuns->offsets);
+	}
+	if (map.columnRuns.has_value())
+	{
+		outS.WriteArray("CollisionColumnRuns", map.columnRuns->runs);
+		outS.WriteArray("CollisionColumnOffsets", map.columnRuns->offsets);
+	}
+	if (map.objPacked.has_value())
+		outS.WriteArray("Objdat", map.objPacked->data);
+	else if (map.objDat.has_value())
+		outS.WriteArray("Objdat", map.objDat.value());
+	if (map.objArrays.has_value())
+	{
+		auto& arrays = map.objArrays.value();
+		outS.WriteArray("ObjIds", arrays.ids);
+		if (!arrays.x16.empty())
+		{
+			outS.WriteArray("ObjX", arrays.x16);
+			outS.WriteArray("ObjY", arrays.y16);
+		}
+		else
+		{
+			outS.WriteArray("ObjX", arrays.x);
+			outS.WriteArray("ObjY", arrays.y);
+		}
+	}
+	for (auto& lut : map.tileLuts)
+	{
+		const std::string suffix = HeaderWriter::TileLutSuffix(p.tileProperties[lut.property], lut.tileset);
+		if (lut.wide)
+		{
+			outS.WriteArray(suffix, lut.values);
+			continue;
+		}
+		std::vector<uint8_t> narrow(lut.values.begin(), lut.values.end());
+		outS.WriteArray(suffix, narrow);
+	}
+	for (auto& field : map.flowFields)
+	{
+		outS.WriteArray("Flow" + std::to_string(field.goal), field.directions);
+		if (!field.distances.empty())
+			outS.WriteArray("Dist" + std::to_string(field.goal), field.distances);
+	}
+	if (map.regions.has_value())
+	{
+		auto& regions = map.regions.value();
+		if (regions.wide)
+		{
+			outS.WriteArray("RegionMap", regions.map);
+			outS.WriteArray("RegionNeighbourOffsets", regions.offsets);
+			outS.WriteArray("RegionNeighbours", regions.neighbours);
+		}
+		else
+		{
+			std::vector<uint8_t> narrowMap(regions.map.begin(), regions.map.end());
+			std::vector<uint8_t> narrowNeighbours(regions.neighbours.begin(), regions.neighbours.end());
+			outS.WriteArray("RegionMap", narrowMap);
+			outS.WriteArray("RegionNeighbourOffsets", regions.offsets);
+			outS.WriteArray("RegionNeighbours", narrowNeighbours);
+		}
+	}
+	for (auto& masks : map.tileMasks)
+	{
+		if (!masks.masks.empty())
+			outS.WriteArray("TileMasks" + std::to_string(masks.tileset), masks.masks);
+		if (!masks.heights.empty())
+			outS.WriteArray("TileHeights" + std::to_string(masks.tileset), masks.heights);
+	}
+	if (map.animations.has_value() && !map.animations->tiles.empty())
+	{
+		auto& anims = map.animations.value();
+		outS.WriteArray("AnimTiles", anims.tiles);
+		outS.WriteArray("AnimTilesets", anims.tilesets);
+		outS.WriteArray("AnimFrameOffsets", anims.frameOffsets);
+		outS.WriteArray("AnimFrames", anims.frames);
+		outS.WriteArray("AnimDurations", anims.durations);
+		outS.WriteArray("AnimPositionOffsets", anims.positionOffsets);
+		outS.WriteArray("AnimPositions", anims.positions);
+	}
+	if (map.objRecords.has_value())
+		outS.WriteArray("ObjProps", map.objRecords->data);
+	if (map.objGrid.has_value())
+		outS.WriteArray("ObjCells", map.objGrid->offsets);
+	if (map.objColumns.has_value())
+		outS.WriteArray("ObjColumns", map.objColumns->index);
+
+	return true;
+}
+
 int main(int argc, char** argv)
 {
 	Arguments p;
@@ -178,79 +1001,74 @@ int main(int argc, char** argv)
 		}
 	}
 
-	// Open & read input file
-	TmxReader tmx;
-	switch (tmx.Open(p.inPath,
-		p.layer, p.paletteLay, p.collisionlay, objMapping))
+	// Pair up inputs & outputs
+	std::vector<Job> jobs;
+	jobs.reserve(p.inPaths.size());
+	for (std::size_t i = 0; i < p.inPaths.size(); ++i)
 	{
-	case TmxReader::Error::LOAD_FAILED:
-		std::cerr << "Failed to open input file." << std::endl;
-		return 1;
-	case TmxReader::Error::NO_LAYERS:
-		std::cerr << "No suitable tile layer found." << std::endl;
-		return 1;
-	case TmxReader::Error::GRAPHICS_NOTFOUND:
-		std::cerr << "No graphics layer \"" << p.layer << "\" found." << std::endl;
-		return 1;
-	case TmxReader::Error::PALETTE_NOTFOUND:
-		std::cerr << "No palette layer \"" << p.paletteLay << "\" found." << std::endl;
-		return 1;
-	case TmxReader::Error::COLLISION_NOTFOUND:
-		std::cerr << "No collision layer \"" << p.collisionlay << "\" found." << std::endl;
-		return 1;
-	case TmxReader::Error::OK:
-		break;
+		const bool batch = p.inPaths.size() > 1;
+		jobs.emplace_back(Job { i, p.inPaths[i], p.outPaths[i], batch ? p.inPaths[i] + ": " : "" });
 	}
 
-	// Get name from file
-	std::string name = SanitiseLabel(std::filesystem::path(p.outPath).stem().string());
+	if (!p.tracePath.empty())
+		profile::EnableTracing();
+	else if (p.timings.has_value())
+		profile::Enable();
 
-	// Open output files
-	SWriter outS;
-	if (!outS.Open(p.outPath + ".s", name))
-	{
-		std::cerr << "Failed to create output file \"" << p.outPath << ".s\".";
-		return 1;
-	}
-	HeaderWriter outH;
-	if (!outH.Open(p.outPath + ".h", name))
-	{
-		std::cerr << "Failed to create output file \"" << p.outPath << ".h\".";
-		return 1;
-	}
-
-	// Convert to GBA-friendly charmap data
-	{
-		std::vector<uint16_t> charDat;
-		if (!convert::ConvertCharmap(charDat, p.offset, p.palette, tmx))
-			return 1;
+	// Read, convert & write each map, stages run concurrently when converting more than one map
+	pipeline::Stats stats;
+	bool ok = pipeline::Run<Job, LoadedMap, ConvertedMap>(jobs, p.threads,
+		[&](const Job& job)
+		{
+			profile::MapScope mapScope(job.index);
+			profile::Scope profile("read", job.inPath.c_str());
+			return ReadMap(job, p, objMapping);
+		},
+		[&](LoadedMap&& loaded)
+		{
+			profile::MapScope mapScope(loaded.job->index);
+			profile::Scope profile("convert", loaded.job->inPath.c_str());
+			return ConvertMap(std::move(loaded), p);
+		},
+		[&](ConvertedMap&& converted)
+		{
+			profile::MapScope mapScope(converted.job->index);
+			profile::Scope profile("write", converted.job->outPath.c_str());
+			return WriteMap(std::move(converted), p);
+		},
+		stats);
 
-		// Write out charmap
-		outH.WriteSize(tmx.GetSize().width, tmx.GetSize().height);
-		outH.WriteCharacterMap(charDat);
-		outS.WriteArray("Tiles", charDat);
-	}
+	if (p.stageStats)
+		pipeline::PrintStats(std::cerr, stats);
 
-	// Convert collision map & write out
-	if (tmx.HasCollisionTiles())
+	if (p.timings.has_value())
 	{
-		std::vector<uint8_t> collisionDat;
-		if (!convert::ConvertCollision(collisionDat, tmx))
-			return 1;
-
-		outH.WriteCollision(collisionDat);
-		outS.WriteArray("Collision", collisionDat, 32);
+		if (p.timingsPath.empty())
+		{
+			profile::Report(std::cerr, p.timings.value(), p.inPaths);
+		}
+		else
+		{
+			std::ofstream timingsFile(p.timingsPath);
+			if (!timingsFile.is_open())
+			{
+				std::cerr << "Failed to create timings file \"" << p.timingsPath << "\"." << std::endl;
+				return 1;
+			}
+			profile::Report(timingsFile, p.timings.value(), p.inPaths);
+		}
 	}
 
-	if (tmx.HasObjects())
+	if (!p.tracePath.empty())
 	{
-		std::vector<uint32_t> objDat;
-		if (!convert::ConvertObjects(objDat, tmx))
+		std::ofstream traceFile(p.tracePath);
+		if (!traceFile.is_open())
+		{
+			std::cerr << "Failed to create trace file \"" << p.tracePath << "\"." << std::endl;
 			return 1;
-
-		outH.WriteObjects(objDat);
-		outS.WriteArray("Objdat", objDat);
+		}
+		profile::WriteTrace(traceFile, p.inPaths);
 	}
 
-	return 0;
+	return ok ? 0 : 1;
 }
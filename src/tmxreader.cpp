@@ -1,19 +1,58 @@
 /* tmxreader.cpp - Copyright (C) 2015-2024 a dinosaur (zlib, see COPYING.txt) */
 
 #include "tmxreader.hpp"
+#include "profile.hpp"
 #include "tmxlite/Map.hpp"
 #include "tmxlite/TileLayer.hpp"
 #include "tmxlite/ObjectGroup.hpp"
 #include <optional>
 #include <algorithm>
+#include <filesystem>
+#include <cmath>
+#include <charconv>
 
 
+static double PropertyValue(const tmx::Property& property)
+{
+	using Type = tmx::Property::Type;
+	switch (property.getType())
+	{
+	case Type::Boolean: return property.getBoolValue() ? 1.0 : 0.0;
+	case Type::Float:   return property.getFloatValue();
+	case Type::Int:     return property.getIntValue();
+	case Type::Object:  return property.getObjectValue();
+	case Type::Colour:  return static_cast<uint32_t>(property.getColourValue());
+	case Type::String:
+	{
+		// Untyped properties from older maps are strings
+		const std::string& str = property.getStringValue();
+		double value;
+		const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+		if (ec == std::errc() && end == str.data() + str.size())
+			return value;
+		return std::nan("");
+	}
+	case Type::File:
+	case Type::Undef:
+		break;
+	}
+	return std::nan("");
+}
+
 TmxReader::Error TmxReader::Open(const std::string& inPath,
 	const std::string_view graphicsName,
 	const std::string_view paletteName,
 	const std::string_view collisionName,
-	const std::map<std::string, uint32_t>& objMapping)
+	const std::map<std::string, uint32_t>& objMapping,
+	std::span<const std::string> objProperties,
+	std::span<const std::string> tileProperties,
+	bool tileShapes, bool animations)
 {
+	profile::Scope profile("TmxReader::Open");
+	std::error_code ec;
+	if (auto fileSize = std::filesystem::file_size(inPath, ec); !ec)
+		profile.SetBytes(fileSize);
+
 	tmx::Map map;
 	if (!map.load(inPath))
 		return Error::LOAD_FAILED;
@@ -61,8 +100,17 @@ TmxReader::Error TmxReader::Open(const std::string& inPath,
 		else
 			return Error::GRAPHICS_NOTFOUND;
 	}
+	bool collisionFromTiles = false;
 	if (layerCls == std::nullopt && !collisionName.empty())
-		return Error::GRAPHICS_NOTFOUND;
+	{
+		// Fall back to a tile property of the same name
+		for (const auto& set : map.getTilesets())
+			for (const auto& tile : set.getTiles())
+				for (const auto& property : tile.properties)
+					collisionFromTiles = collisionFromTiles || property.getName() == collisionName;
+		if (!collisionFromTiles)
+			return Error::COLLISION_NOTFOUND;
+	}
 	if (layerPal == std::nullopt && !paletteName.empty())
 		return Error::PALETTE_NOTFOUND;
 
@@ -99,6 +147,97 @@ TmxReader::Error TmxReader::Open(const std::string& inPath,
 	for (const auto& set : tilesets)
 		mGidTable.emplace_back(std::make_pair(set.getFirstGID(), set.getLastGID()));
 
+	if (collisionFromTiles)
+	{
+		std::vector<double> v(tilesets.empty() ? 0 : tilesets.back().getLastGID() + 1, 0.0);
+		for (const auto& set : tilesets)
+		{
+			for (const auto& tile : set.getTiles())
+			{
+				const uint32_t gid = set.getFirstGID() + tile.ID;
+				if (tile.ID >= set.getTileCount() || gid >= v.size())
+					continue;
+				for (const auto& property : tile.properties)
+					if (property.getName() == collisionName)
+						v[gid] = PropertyValue(property);
+			}
+		}
+		mCollisionProperty.emplace(std::move(v));
+	}
+
+	// Read tile collision shapes, points & text aren't shapes that can be collided with
+	if (tileShapes)
+	{
+		mTileShapes.reserve(tilesets.size());
+		for (const auto& set : tilesets)
+		{
+			TilesetShapes& shapes = mTileShapes.emplace_back(TilesetShapes {
+				set.getTileSize().x, set.getTileSize().y, std::vector<std::vector<Shape>>(set.getTileCount()) });
+			for (const auto& tile : set.getTiles())
+			{
+				if (tile.ID >= set.getTileCount())
+					continue;
+				for (const auto& tmxObj : tile.objectGroup.getObjects())
+				{
+					const auto& aabb = tmxObj.getAABB();
+					Shape shape { Shape::Type::RECTANGLE, tmxObj.getPosition().x, tmxObj.getPosition().y,
+						aabb.width, aabb.height, tmxObj.getRotation(), {} };
+					switch (tmxObj.getShape())
+					{
+					case tmx::Object::Shape::Rectangle: break;
+					case tmx::Object::Shape::Ellipse: shape.type = Shape::Type::ELLIPSE; break;
+					case tmx::Object::Shape::Polygon:
+						shape.type = Shape::Type::POLYGON;
+						for (const auto& point : tmxObj.getPoints())
+							shape.points.emplace_back(point.x, point.y);
+						break;
+					default:
+						continue;
+					}
+					shapes.tiles[tile.ID].emplace_back(std::move(shape));
+				}
+			}
+		}
+	}
+
+	// Read requested tile properties
+	if (!tileProperties.empty())
+	{
+		mTileProperties.reserve(tilesets.size());
+		for (const auto& set : tilesets)
+		{
+			TilesetProperties& props = mTileProperties.emplace_back();
+			props.values.assign(tileProperties.size(), std::vector<double>(set.getTileCount(), 0.0));
+			for (const auto& tile : set.getTiles())
+			{
+				if (tile.ID >= set.getTileCount())
+					continue;
+				for (const auto& property : tile.properties)
+				{
+					auto found = std::find(tileProperties.begin(), tileProperties.end(), property.getName());
+					if (found != tileProperties.end())
+						props.values[found - tileProperties.begin()][tile.ID] = PropertyValue(property);
+				}
+			}
+		}
+	}
+
+	// Read tile animations
+	if (animations)
+	{
+		for (const auto& [gid, tile] : map.getAnimatedTiles())
+		{
+			Animation anim { gid, 0, {} };
+			for (unsigned i = 0; i < mGidTable.size(); ++i)
+				if (gid >= mGidTable[i].first && gid <= mGidTable[i].second)
+					anim.tileset = i;
+			anim.frames.reserve(tile.animation.frames.size());
+			for (const auto& frame : tile.animation.frames)
+				anim.frames.emplace_back(Frame { frame.tileID, frame.duration });
+			mAnimations.emplace_back(std::move(anim));
+		}
+	}
+
 	// Read objects
 	if (!objMapping.empty())
 	{
@@ -119,6 +258,14 @@ TmxReader::Error TmxReader::Open(const std::string& inPath,
 				obj.x = aabb.left;
 				obj.y = aabb.top;
 
+				obj.properties.assign(objProperties.size(), 0.0);
+				for (const auto& property : tmxObj.getProperties())
+				{
+					auto found = std::find(objProperties.begin(), objProperties.end(), property.getName());
+					if (found != objProperties.end())
+						obj.properties[found - objProperties.begin()] = PropertyValue(property);
+				}
+
 				v.emplace_back(obj);
 			}
 		}
@@ -9,6 +9,7 @@
 #include <span>
 #include <vector>
 #include <map>
+#include <utility>
 #include <optional>
 
 class TmxReader
@@ -33,7 +34,10 @@ public:
 		const std::string_view graphicsName,
 		const std::string_view paletteName,
 		const std::string_view collisionName,
-		const std::map<std::string, uint32_t>& objMapping);
+		const std::map<std::string, uint32_t>& objMapping,
+		std::span<const std::string> objProperties = {},
+		std::span<const std::string> tileProperties = {},
+		bool tileShapes = false, bool animations = false);
 	struct Size { unsigned width, height; };
 
 	[[nodiscard]] constexpr Size GetSize() const { return mSize; }
@@ -44,9 +48,33 @@ public:
 	[[nodiscard]] uint32_t LidFromGid(uint32_t aGid) const;
 
 	struct Tile { uint32_t id; uint8_t flags; };
-	struct Object { unsigned id; float x, y; };
+	// Properties holds the value of each requested property in order, 0 when an object doesn't
+	//  have it & NaN when its value isn't numeric
+	struct Object { unsigned id; float x, y; std::vector<double> properties; };
 
-	[[nodiscard]] constexpr bool HasCollisionTiles() const { return mCollision.has_value(); }
+	// Tile animation from a tileset, frame durations are in milliseconds
+	struct Frame { uint32_t gid; uint32_t duration; };
+	struct Animation { uint32_t gid; unsigned tileset; std::vector<Frame> frames; };
+
+	// Values of each requested tile property for every tile of a tileset indexed by LID - 1,
+	//  same conventions as object properties
+	struct TilesetProperties { std::vector<std::vector<double>> values; };
+
+	// Collision shape of a tile in pixels relative to the tile, rotated clockwise in degrees
+	//  around its position, polygon points are relative to the position
+	struct Shape
+	{
+		enum class Type { RECTANGLE, ELLIPSE, POLYGON } type;
+		float x, y, width, height, rotation;
+		std::vector<std::pair<float, float>> points;
+	};
+	struct TilesetShapes
+	{
+		unsigned tileWidth, tileHeight;
+		std::vector<std::vector<Shape>> tiles;  // Indexed by LID - 1
+	};
+
+	[[nodiscard]] constexpr bool HasCollisionTiles() const { return mCollision.has_value() || mCollisionProperty.has_value(); }
 	[[nodiscard]] constexpr bool HasObjects() const { return mObjects.has_value(); }
 
 	[[nodiscard]] constexpr const std::span<const Tile> GetGraphicsTiles() const { return mGraphics; }
@@ -60,11 +88,23 @@ public:
 		if (mCollision.has_value()) { return { mCollision.value() }; }
 		return std::nullopt;
 	}
+	// When there's no collision layer of the requested name the tile property of that name gives the
+	//  collision of each graphics tile instead, indexed by GID
+	[[nodiscard]] constexpr const std::optional<std::span<const double>> GetCollisionProperty() const
+	{
+		if (mCollisionProperty.has_value()) { return { mCollisionProperty.value() }; }
+		return std::nullopt;
+	}
 	[[nodiscard]] constexpr const std::optional<std::span<const Object>> GetObjects() const
 	{
 		if (mObjects.has_value()) { return { mObjects.value() }; }
 		return std::nullopt;
 	}
+	// Every animated tile in the map's tilesets in GID order, empty unless requested when opened
+	[[nodiscard]] constexpr const std::span<const Animation> GetAnimations() const { return mAnimations; }
+	// One per tileset in GID order, empty unless requested when opened
+	[[nodiscard]] constexpr const std::span<const TilesetProperties> GetTileProperties() const { return mTileProperties; }
+	[[nodiscard]] constexpr const std::span<const TilesetShapes> GetTileShapes() const { return mTileShapes; }
 
 private:
 	Size mSize;
@@ -74,7 +114,11 @@ private:
 	std::vector<Tile> mGraphics;
 	std::optional<std::vector<uint32_t>> mPalette;
 	std::optional<std::vector<uint32_t>> mCollision;
+	std::optional<std::vector<double>> mCollisionProperty;
 	std::optional<std::vector<Object>> mObjects;
+	std::vector<Animation> mAnimations;
+	std::vector<TilesetProperties> mTileProperties;
+	std::vector<TilesetShapes> mTileShapes;
 };
 
 #endif//TMXREADER_HPP